@@ -0,0 +1,678 @@
+/** ZCT/bitbase.c--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+#include "functions.h"
+#include "globals.h"
+#include "smp.h"
+#include "bit.h"
+#include <ctype.h>
+
+/* The endings we know about. The three piece tables are small enough to be
+	generated at startup, the others are loaded from a file if there is one,
+	and can be generated with the "bitbase" command. The tables that other
+	tables depend on (for captures and promotions) have to come first. */
+const char bitbase_name[BITBASE_COUNT][8] =
+	{ "KQK", "KRK", "KPK", "KBNK", "KQKR" };
+
+/* The bitbases are in shared memory, so that they can be generated in
+	parallel and the children see them as soon as they're ready. */
+BITBASE *bitbase;
+
+/* Index of the strong king square, and the square for each index: the
+	a1-d1-d4 triangle for tables using all symmetries, and files a-d for tables
+	with pawns. */
+int bitbase_king_index[2][64];
+SQUARE bitbase_king_square[2][32];
+
+#define BITBASE_BIT(bb, i)		((bb)->table[(i) >> 6] >> ((i) & 63) & 1)
+#define BITBASE_CHUNK			(64 * 64)
+
+/**
+initialize_bitbases():
+Sets up the bitbase definitions and allocates the tables. The three piece
+tables are generated, and the bigger ones are loaded from the current
+directory if they have been generated before. This must be called before the
+child processors are started.
+Created 101926; last modified 101926
+**/
+void initialize_bitbases(void)
+{
+	char file_name[16];
+	char *c;
+	int count[2];
+	int x;
+	int y;
+	COLOR color;
+	PIECE piece;
+	SQUARE square;
+	BITBASE *bb;
+
+	/* Set up the king indices. */
+	count[0] = count[1] = 0;
+	for (square = A1; square < OFF_BOARD; square++)
+	{
+		bitbase_king_index[0][square] = bitbase_king_index[1][square] = -1;
+		if (FILE_OF(square) <= FILE_D)
+		{
+			bitbase_king_square[0][count[0]] = square;
+			bitbase_king_index[0][square] = count[0]++;
+			if (RANK_OF(square) <= FILE_OF(square))
+			{
+				bitbase_king_square[1][count[1]] = square;
+				bitbase_king_index[1][square] = count[1]++;
+			}
+		}
+	}
+
+#ifdef SMP
+	bitbase = (BITBASE *)shared_alloc(BITBASE_COUNT * sizeof(BITBASE));
+#else
+	if ((bitbase = (BITBASE *)calloc(BITBASE_COUNT, sizeof(BITBASE))) == NULL)
+		fatal_error("fatal error: could not allocate bitbases.\n");
+#endif
+	for (x = 0; x < BITBASE_COUNT; x++)
+	{
+		bb = &bitbase[x];
+		strcpy(bb->name, bitbase_name[x]);
+
+		/* Parse the name: the pieces up to the second king belong to the
+			strong side. */
+		bb->piece[0] = bb->piece[1] = KING;
+		bb->color[0] = WHITE;
+		bb->color[1] = BLACK;
+		bb->piece_count = 2;
+		bb->symmetric = TRUE;
+		bb->exact = TRUE;
+		color = WHITE;
+		for (c = bb->name + 1; *c; c++)
+		{
+			for (piece = PAWN; piece_char[WHITE][piece] != *c; piece++)
+				;
+			if (piece == KING)
+			{
+				color = BLACK;
+				continue;
+			}
+			if (piece == PAWN)
+				bb->symmetric = FALSE;
+			/* If the weak side has anything but a king, it might be able to
+				win, so a position that the strong side doesn't win isn't
+				necessarily a draw. */
+			if (color == BLACK)
+				bb->exact = FALSE;
+			bb->piece[bb->piece_count] = piece;
+			bb->color[bb->piece_count++] = color;
+		}
+
+		bb->size = count[bb->symmetric];
+		for (y = 1; y < bb->piece_count; y++)
+			bb->size *= 64;
+#ifdef SMP
+		bb->table = (BITBOARD *)shared_alloc(2 * bb->size / 8);
+#else
+		if ((bb->table = (BITBOARD *)calloc(2 * bb->size / 64,
+			sizeof(BITBOARD))) == NULL)
+			fatal_error("fatal error: could not allocate bitbases.\n");
+#endif
+		bb->ready = FALSE;
+
+		if (bb->piece_count <= 3)
+			bitbase_generate(bb);
+		else
+		{
+			bitbase_file_name(bb, file_name);
+			bitbase_load(bb, file_name);
+		}
+	}
+}
+
+/**
+bitbase_file_name():
+Returns the name of the file that the given bitbase is saved in.
+Created 101926; last modified 101926
+**/
+void bitbase_file_name(BITBASE *bb, char *file_name)
+{
+	char *c;
+
+	strcpy(file_name, bb->name);
+	for (c = file_name; *c; c++)
+		*c = tolower(*c);
+	strcat(file_name, ".zbb");
+}
+
+/**
+bitbase_load():
+Loads a bitbase from a file, as written by bitbase_save(). Returns TRUE if the
+table was loaded.
+Created 101926; last modified 101926
+**/
+BOOL bitbase_load(BITBASE *bb, char *file_name)
+{
+	FILE *file;
+	BITBOARD words;
+
+	if ((file = fopen(file_name, "rb")) == NULL)
+		return FALSE;
+	words = 2 * bb->size / 64;
+	bb->ready = (fread(bb->table, sizeof(BITBOARD), words, file) == words &&
+		fgetc(file) == EOF);
+	fclose(file);
+	return bb->ready;
+}
+
+/**
+bitbase_save():
+Saves a bitbase to a file. Returns TRUE on success.
+Created 101926; last modified 101926
+**/
+BOOL bitbase_save(BITBASE *bb, char *file_name)
+{
+	FILE *file;
+	BITBOARD words;
+	BOOL r;
+
+	if ((file = fopen(file_name, "wb")) == NULL)
+		return FALSE;
+	words = 2 * bb->size / 64;
+	r = (fwrite(bb->table, sizeof(BITBOARD), words, file) == words);
+	fclose(file);
+	return r;
+}
+
+/**
+bitbase_transform():
+Applies a symmetry to a square: bit 0 mirrors the files, bit 1 mirrors the
+ranks, and bit 2 mirrors along the a1-h8 diagonal.
+Created 101926; last modified 101926
+**/
+SQUARE bitbase_transform(SQUARE square, int t)
+{
+	if (t & 1)
+		square ^= 7;
+	if (t & 2)
+		square ^= 0x38;
+	if (t & 4)
+		square = SQ_FROM_RF(FILE_OF(square), RANK_OF(square));
+	return square;
+}
+
+/**
+bitbase_index():
+Returns the index of the position with the given squares (in the order of the
+bitbase's pieces, with the strong side as white) and side to move.
+Created 101926; last modified 101926
+**/
+BITBOARD bitbase_index(BITBASE *bb, SQUARE *square, COLOR side_tm)
+{
+	BITBOARD index;
+	SQUARE king;
+	int t;
+	int x;
+
+	/* Find the symmetry that brings the strong king into its region. */
+	t = (FILE_OF(square[0]) > FILE_D);
+	if (bb->symmetric)
+	{
+		t |= (RANK_OF(square[0]) > RANK_4) << 1;
+		king = bitbase_transform(square[0], t);
+		if (RANK_OF(king) > FILE_OF(king))
+			t |= 4;
+	}
+	index = bitbase_king_index[bb->symmetric]
+		[bitbase_transform(square[0], t)];
+	for (x = 1; x < bb->piece_count; x++)
+		index = index * 64 + bitbase_transform(square[x], t);
+	return side_tm * bb->size + index;
+}
+
+/**
+bitbase_squares():
+The reverse of bitbase_index(): fills in the squares of the position with the
+given index, and returns the side to move.
+Created 101926; last modified 101926
+**/
+COLOR bitbase_squares(BITBASE *bb, BITBOARD index, SQUARE *square)
+{
+	COLOR side_tm;
+	int x;
+
+	side_tm = (index >= bb->size);
+	index -= side_tm * bb->size;
+	for (x = bb->piece_count - 1; x > 0; x--)
+	{
+		square[x] = (SQUARE)(index & 63);
+		index >>= 6;
+	}
+	square[0] = bitbase_king_square[bb->symmetric][index];
+	return side_tm;
+}
+
+/**
+bitbase_match():
+Finds the bitbase for a set of pieces. The squares are put into the order of
+the bitbase's pieces, and flipped if black is the strong side, in bb_square.
+Returns NULL if there is no bitbase for these pieces.
+Created 101926; last modified 101926
+**/
+BITBASE *bitbase_match(int count, PIECE *piece, COLOR *color, SQUARE *square,
+	SQUARE *bb_square, COLOR *strong)
+{
+	BOOL used[BITBASE_MAX_PIECES];
+	int b;
+	int x;
+	int y;
+	BITBASE *bb;
+
+	for (b = 0; b < BITBASE_COUNT; b++)
+	{
+		bb = &bitbase[b];
+		if (bb->piece_count != count)
+			continue;
+		for (*strong = WHITE; *strong <= BLACK; (*strong)++)
+		{
+			for (y = 0; y < count; y++)
+				used[y] = FALSE;
+			for (x = 0; x < count; x++)
+			{
+				for (y = 0; y < count; y++)
+				{
+					if (!used[y] && piece[y] == bb->piece[x] &&
+						(color[y] == *strong) == (bb->color[x] == WHITE))
+						break;
+				}
+				if (y == count)
+					break;
+				used[y] = TRUE;
+				bb_square[x] = SQ_FLIP_COLOR(square[y], *strong);
+			}
+			if (x == count)
+				return bb;
+		}
+	}
+	return NULL;
+}
+
+/**
+bitbase_lookup():
+Looks up a position given as a list of pieces in the bitbases, and returns
+the color of the side that wins, or EMPTY if neither side is known to win.
+Created 101926; last modified 101926
+**/
+COLOR bitbase_lookup(int count, PIECE *piece, COLOR *color, SQUARE *square,
+	COLOR side_tm)
+{
+	SQUARE bb_square[BITBASE_MAX_PIECES];
+	COLOR strong;
+	BITBASE *bb;
+	BITBOARD index;
+
+	bb = bitbase_match(count, piece, color, square, bb_square, &strong);
+	if (bb == NULL || !bb->ready)
+		return EMPTY;
+	index = bitbase_index(bb, bb_square, side_tm ^ strong);
+	return BITBASE_BIT(bb, index) ? strong : EMPTY;
+}
+
+/**
+bitbase_probe():
+Probes the bitbases for the position on the board. If the position is in a
+bitbase and the result is known, the value is set to a win, loss, or draw
+score for the side to move (not adjusted for ply), and TRUE is returned.
+Created 101926; last modified 101926
+**/
+BOOL bitbase_probe(VALUE *value)
+{
+	PIECE piece[BITBASE_MAX_PIECES];
+	COLOR color[BITBASE_MAX_PIECES];
+	SQUARE square[BITBASE_MAX_PIECES];
+	SQUARE bb_square[BITBASE_MAX_PIECES];
+	COLOR strong;
+	BITBOARD pieces;
+	BITBASE *bb;
+	SQUARE sq;
+	int count;
+
+	/* The tables don't know about castling. */
+	if (pop_count(board.occupied_bb) > BITBASE_MAX_PIECES ||
+		board.castle_rights)
+		return FALSE;
+
+	count = 0;
+	pieces = board.occupied_bb;
+	FOR_BB(sq, pieces)
+	{
+		piece[count] = board.piece[sq];
+		color[count] = board.color[sq];
+		square[count++] = sq;
+	}
+	bb = bitbase_match(count, piece, color, square, bb_square, &strong);
+	if (bb == NULL || !bb->ready)
+		return FALSE;
+
+	if (BITBASE_BIT(bb, bitbase_index(bb, bb_square, board.side_tm ^ strong)))
+		*value = (board.side_tm == strong ? BITBASE_WIN : -BITBASE_WIN);
+	else if (bb->exact)
+		*value = DRAW;
+	else
+		return FALSE;
+	return TRUE;
+}
+
+/**
+bitbase_attacks():
+Returns the squares attacked by a piece, given the occupied squares.
+Created 101926; last modified 101926
+**/
+BITBOARD bitbase_attacks(PIECE piece, COLOR color, SQUARE square,
+	BITBOARD occupied)
+{
+	switch (piece)
+	{
+		case PAWN:
+			return pawn_caps_bb[color][square];
+		case KNIGHT:
+			return knight_moves_bb[square];
+		case BISHOP:
+			return BISHOP_ATTACKS(square, occupied);
+		case ROOK:
+			return ROOK_ATTACKS(square, occupied);
+		case QUEEN:
+			return QUEEN_ATTACKS(square, occupied);
+		case KING:
+			return king_moves_bb[square];
+	}
+	return 0;
+}
+
+/**
+bitbase_attacked():
+Returns whether the given square is attacked by any of the pieces of the
+given color in the list.
+Created 101926; last modified 101926
+**/
+BOOL bitbase_attacked(int count, PIECE *piece, COLOR *color, SQUARE *square,
+	BITBOARD occupied, SQUARE target, COLOR attacker)
+{
+	int x;
+
+	for (x = 0; x < count; x++)
+	{
+		if (color[x] == attacker && bitbase_attacks(piece[x], color[x],
+			square[x], occupied) & MASK(target))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+bitbase_child():
+Finds out what happens after the piece with the given index moves to the
+given square in a position of the bitbase being generated. Returns -1 if the
+move is illegal, otherwise whether the strong side wins afterwards. Captures
+and promotions go to the other bitbases, and positions that aren't in any
+bitbase (such as bare kings) aren't wins.
+Created 101926; last modified 101926
+**/
+int bitbase_child(BITBASE *bb, SQUARE *square, int index, SQUARE to,
+	PIECE promote)
+{
+	PIECE piece[BITBASE_MAX_PIECES];
+	COLOR color[BITBASE_MAX_PIECES];
+	SQUARE new_square[BITBASE_MAX_PIECES];
+	BITBOARD occupied;
+	COLOR side;
+	SQUARE king;
+	int count;
+	int x;
+
+	side = bb->color[index];
+	count = 0;
+	occupied = 0;
+	king = OFF_BOARD;
+	for (x = 0; x < bb->piece_count; x++)
+	{
+		/* Captured piece */
+		if (square[x] == to)
+			continue;
+		piece[count] = bb->piece[x];
+		color[count] = bb->color[x];
+		new_square[count] = square[x];
+		if (x == index)
+		{
+			new_square[count] = to;
+			if (promote != EMPTY)
+				piece[count] = promote;
+		}
+		if (piece[count] == KING && color[count] == side)
+			king = new_square[count];
+		occupied |= MASK(new_square[count]);
+		count++;
+	}
+
+	if (bitbase_attacked(count, piece, color, new_square, occupied, king,
+		COLOR_FLIP(side)))
+		return -1;
+
+	if (count == bb->piece_count && promote == EMPTY)
+		return BITBASE_BIT(bb, bitbase_index(bb, new_square, COLOR_FLIP(side)));
+	return bitbase_lookup(count, piece, color, new_square,
+		COLOR_FLIP(side)) == WHITE;
+}
+
+/**
+bitbase_generate_position():
+Determines if the position with the given index is a win for the strong
+side, given the positions already known to be wins. With the strong side to
+move, one move to a win is enough; with the weak side to move, every move
+must lose, or the weak side must be checkmated. Illegal positions aren't wins.
+Created 101926; last modified 101926
+**/
+BOOL bitbase_generate_position(BITBASE *bb, BITBOARD index)
+{
+	SQUARE square[BITBASE_MAX_PIECES];
+	BITBOARD occupied;
+	BITBOARD own;
+	BITBOARD moves;
+	COLOR side_tm;
+	SQUARE to;
+	PIECE promote;
+	int legal;
+	int r;
+	int x;
+
+	side_tm = bitbase_squares(bb, index, square);
+
+	/* Weed out the broken positions. */
+	occupied = own = 0;
+	for (x = 0; x < bb->piece_count; x++)
+	{
+		if (occupied & MASK(square[x]))
+			return FALSE;
+		if (bb->piece[x] == PAWN && (RANK_OF(square[x]) == RANK_1 ||
+			RANK_OF(square[x]) == RANK_8))
+			return FALSE;
+		occupied |= MASK(square[x]);
+		if (bb->color[x] == side_tm)
+			own |= MASK(square[x]);
+	}
+	/* The side that just moved can't be in check. */
+	if (bitbase_attacked(bb->piece_count, bb->piece, bb->color, square,
+		occupied, square[COLOR_FLIP(side_tm)], side_tm))
+		return FALSE;
+
+	legal = 0;
+	for (x = 0; x < bb->piece_count; x++)
+	{
+		if (bb->color[x] != side_tm)
+			continue;
+		if (bb->piece[x] == PAWN)
+		{
+			moves = pawn_caps_bb[side_tm][square[x]] & occupied & ~own;
+			to = square[x] + pawn_step[side_tm];
+			if (!(occupied & MASK(to)))
+			{
+				moves |= MASK(to);
+				to += pawn_step[side_tm];
+				if (RANK_OF(SQ_FLIP_COLOR(square[x], side_tm)) == RANK_2 &&
+					!(occupied & MASK(to)))
+					moves |= MASK(to);
+			}
+		}
+		else
+			moves = bitbase_attacks(bb->piece[x], side_tm, square[x],
+				occupied) & ~own;
+
+		FOR_BB(to, moves)
+		{
+			promote = EMPTY;
+			if (bb->piece[x] == PAWN &&
+				RANK_OF(SQ_FLIP_COLOR(to, side_tm)) == RANK_8)
+				promote = QUEEN;
+			do
+			{
+				r = bitbase_child(bb, square, x, to, promote);
+				if (r == -1)
+					continue;
+				legal++;
+				if (side_tm == WHITE && r)
+					return TRUE;
+				if (side_tm == BLACK && !r)
+					return FALSE;
+			} while (promote != EMPTY && --promote >= KNIGHT);
+		}
+	}
+
+	if (side_tm == WHITE)
+		return FALSE;
+	/* The weak side has no moves: checkmate or stalemate. */
+	if (legal == 0)
+		return bitbase_attacked(bb->piece_count, bb->piece, bb->color,
+			square, occupied, square[BLACK], WHITE);
+	return TRUE;
+}
+
+/**
+bitbase_generate_range():
+Makes one pass over a range of positions, marking the positions that are now
+known to be wins. The range must cover whole words of the table, so that
+processors working on different ranges never write to the same word.
+Returns TRUE if any new wins were found.
+Created 101926; last modified 101926
+**/
+BOOL bitbase_generate_range(BITBASE *bb, BITBOARD start, BITBOARD end)
+{
+	BITBOARD index;
+	BOOL changed;
+
+	changed = FALSE;
+	for (index = start; index < end; index++)
+	{
+		if (!BITBASE_BIT(bb, index) && bitbase_generate_position(bb, index))
+		{
+			bb->table[index >> 6] |= (BITBOARD)1 << (index & 63);
+			changed = TRUE;
+		}
+	}
+	return changed;
+}
+
+/**
+bitbase_generate():
+Generates a bitbase by retrograde analysis. Starting with no known wins, we
+keep making passes over the whole table until no new wins are found; the
+first pass finds the mates, the next the mates in one, and so on, although
+since the passes update the table in place they usually get further. With
+more than one processor, the children are woken up to help with each pass.
+Created 101926; last modified 101926
+**/
+void bitbase_generate(BITBASE *bb)
+{
+	BOOL changed;
+#ifdef SMP
+	int p;
+#endif
+
+	bb->ready = FALSE;
+	memset(bb->table, 0, 2 * bb->size / 8);
+	do
+	{
+#ifdef SMP
+		if (zct->process_count > 1 && smp_data != NULL)
+		{
+			smp_data->bitbase_id = bb - bitbase;
+			smp_data->bitbase_next = 0;
+			smp_data->bitbase_done = 0;
+			smp_data->bitbase_changed = FALSE;
+
+			for (p = 1; p < zct->process_count; p++)
+			{
+				make_active(p);
+				smp_tell(p, SMP_BITBASE, 0);
+			}
+			bitbase_generate_work();
+			while (smp_data->bitbase_done < 2 * bb->size)
+				;
+			for (p = 1; p < zct->process_count; p++)
+				make_idle(p);
+
+			changed = smp_data->bitbase_changed;
+		}
+		else
+#endif
+			changed = bitbase_generate_range(bb, 0, 2 * bb->size);
+	} while (changed);
+	bb->ready = TRUE;
+}
+
+#ifdef SMP
+/**
+bitbase_generate_work():
+Grabs chunks of the bitbase being generated and makes a pass over them, until
+the whole table has been covered.
+Created 101926; last modified 101926
+**/
+void bitbase_generate_work(void)
+{
+	BITBASE *bb;
+	BITBOARD start;
+	BITBOARD end;
+
+	bb = &bitbase[smp_data->bitbase_id];
+	while (TRUE)
+	{
+		LOCK(smp_data->bitbase_lock);
+		start = smp_data->bitbase_next;
+		end = MIN(start + BITBASE_CHUNK, 2 * bb->size);
+		smp_data->bitbase_next = end;
+		UNLOCK(smp_data->bitbase_lock);
+
+		if (start >= end)
+			break;
+
+		if (bitbase_generate_range(bb, start, end))
+			smp_data->bitbase_changed = TRUE;
+
+		LOCK(smp_data->bitbase_lock);
+		smp_data->bitbase_done += end - start;
+		UNLOCK(smp_data->bitbase_lock);
+	}
+}
+#endif
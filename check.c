@@ -77,6 +77,21 @@ BOOL is_attacked(SQUARE square, COLOR color)
 	return FALSE;
 }
 
+/**
+is_attacked_cached():
+Returns TRUE if the given square is attacked by the given side, using the
+attack maps from the eval block when they are available. The maps are a
+superset of the real attacks, so only a miss can be trusted.
+Created 101926; last modified 101926
+**/
+BOOL is_attacked_cached(EVAL_BLOCK *eval_block, SQUARE square, COLOR color)
+{
+	if (eval_block != NULL && eval_block->attacks[color] != 0 &&
+		!(eval_block->attacks[color] & MASK(square)))
+		return FALSE;
+	return is_attacked(square, color);
+}
+
 /**
 attack_squares():
 Returns a bitboard of all pieces of a given side attacking the given square.
@@ -94,23 +109,130 @@ BITBOARD attack_squares(SQUARE square, COLOR color)
 		(king_moves_bb[square] & board.piece_bb[KING]));
 }
 
+/**
+get_check_info():
+Calculates the squares from which each piece type of the side to move would
+give check, and the pieces that would give a discovered check by moving. This
+is done once per position, so that move_gives_check() is just a few lookups.
+Created 101926; last modified 101926
+**/
+void get_check_info(CHECK_INFO *ci)
+{
+	BITBOARD blockers;
+	BITBOARD sliders;
+	BITBOARD between;
+	SQUARE king_sq;
+	SQUARE slider_sq;
+
+	king_sq = board.king_square[board.side_ntm];
+	ci->direct[PAWN] = pawn_caps_bb[board.side_ntm][king_sq];
+	ci->direct[KNIGHT] = knight_moves_bb[king_sq];
+	ci->direct[BISHOP] = attacks_bb(BISHOP, king_sq);
+	ci->direct[ROOK] = attacks_bb(ROOK, king_sq);
+	ci->direct[QUEEN] = ci->direct[BISHOP] | ci->direct[ROOK];
+	ci->direct[KING] = 0;
+
+	/* Discovered checks: take out our pieces that are next to the king on a
+		line, and see which of our sliders are behind them. */
+	blockers = ci->direct[QUEEN] & board.color_bb[board.side_tm];
+	sliders = board.color_bb[board.side_tm] &
+		((BISHOP_ATTACKS(king_sq, board.occupied_bb ^ blockers) &
+			(board.piece_bb[BISHOP] | board.piece_bb[QUEEN])) |
+		(ROOK_ATTACKS(king_sq, board.occupied_bb ^ blockers) &
+			(board.piece_bb[ROOK] | board.piece_bb[QUEEN])));
+	ci->discovered = 0;
+	FOR_BB(slider_sq, sliders)
+	{
+		/* The slider must be blocked by exactly one of our pieces. */
+		between = in_between_bb[king_sq][slider_sq] & board.occupied_bb;
+		if (between && !(between & (between - 1)) && (between & blockers))
+			ci->discovered |= between;
+	}
+}
+
 /**
 move_gives_check():
-Simply enough, looks to see if the given move in the current position is a checking move.
-Created 052408; last modified 052408
+Looks to see if the given move in the current position is a checking move,
+using the information from get_check_info(). Normal moves are tested with just
+a few bitboard lookups; promotions, en passant, and castling change the
+occupancy in more ways, so their attacks on the king are calculated directly.
+Created 052408; last modified 101926
 **/
-BOOL move_gives_check(MOVE move)
+BOOL move_gives_check(MOVE move, CHECK_INFO *ci)
 {
-	BOOL check;
+	BITBOARD occupied;
+	BITBOARD pieces;
+	PIECE piece;
+	SQUARE from;
+	SQUARE to;
+	SQUARE king_sq;
+
+	from = MOVE_FROM(move);
+	to = MOVE_TO(move);
+	piece = board.piece[from];
+	king_sq = board.king_square[board.side_ntm];
 
-	if (make_move(move))
+	if (!MOVE_PROMOTE(move) && !(piece == PAWN && to == board.ep_square) &&
+		!(piece == KING && ABS(to - from) == 2))
 	{
-		check = in_check();
-		unmake_move();
-		return check;
+		/* direct check */
+		if (ci->direct[piece] & MASK(to))
+			return TRUE;
+		/* discovered check, if the piece leaves the line to the king */
+		return (ci->discovered & MASK(from)) &&
+			!(in_between_bb[king_sq][from] & MASK(to)) &&
+			!(in_between_bb[king_sq][to] & MASK(from));
 	}
+
+	/* Get the occupied state after the move. */
+	occupied = (board.occupied_bb & ~MASK(from)) | MASK(to);
+	pieces = board.color_bb[board.side_tm] & ~MASK(from);
+	if (MOVE_PROMOTE(move))
+		piece = MOVE_PROMOTE(move);
+	else if (piece == PAWN)
+		occupied ^= MASK(to - pawn_step[board.side_tm]);
 	else
-		return FALSE;
+	{
+		/* For castling, the rook is what can give check. */
+		piece = ROOK;
+		from = (to > from ? from + 3 : from - 4);
+		to = (to > MOVE_FROM(move) ? MOVE_FROM(move) + 1 :
+			MOVE_FROM(move) - 1);
+		occupied = (occupied & ~MASK(from)) | MASK(to);
+		pieces &= ~MASK(from);
+	}
+
+	/* The moved piece checks the king. */
+	switch (piece)
+	{
+		case PAWN:
+			if (pawn_caps_bb[board.side_tm][to] & MASK(king_sq))
+				return TRUE;
+			break;
+		case KNIGHT:
+			if (knight_moves_bb[to] & MASK(king_sq))
+				return TRUE;
+			break;
+		case BISHOP:
+			if (BISHOP_ATTACKS(to, occupied) & MASK(king_sq))
+				return TRUE;
+			break;
+		case ROOK:
+			if (ROOK_ATTACKS(to, occupied) & MASK(king_sq))
+				return TRUE;
+			break;
+		case QUEEN:
+			if (QUEEN_ATTACKS(to, occupied) & MASK(king_sq))
+				return TRUE;
+			break;
+		default:
+			break;
+	}
+	/* Another slider checks the king through the new occupancy. */
+	return ((BISHOP_ATTACKS(king_sq, occupied) & pieces &
+		(board.piece_bb[BISHOP] | board.piece_bb[QUEEN])) |
+		(ROOK_ATTACKS(king_sq, occupied) & pieces &
+		(board.piece_bb[ROOK] | board.piece_bb[QUEEN]))) != 0;
 }
 
 /**
@@ -303,31 +425,16 @@ BOOL is_repetition(int limit)
 }
 
 /**
-is_quiet():
-This function determines whether the current board position is quiet.
-It performs two quiescent searches, one for each side. The idea is that
-if the position is quiet, the evaluations will match as neither side can
-make a good move. This idea is from Tord Romstad.
-Created 082008; last modified 082008
+qsearch_value():
+Runs a quiescence search on the current position with a full window, and
+returns the value from the side to move's point of view.
+Created 101926; last modified 101926
 **/
-BOOL is_quiet(void)
+VALUE qsearch_value(void)
 {
-	VALUE value_1;
-	VALUE value_2;
-
-	search_call(&board.search_stack[0], TRUE, 0, 1, -MATE, MATE,
-		board.move_stack, NODE_PV, SEARCH_RETURN);
-	value_1 = -search(&board.search_stack[1]);
-
-	make_move(NULL_MOVE);
 	search_call(&board.search_stack[0], TRUE, 0, 1, -MATE, MATE,
 		board.move_stack, NODE_PV, SEARCH_RETURN);
-	value_2 = -search(&board.search_stack[1]);
-	unmake_move();
-
-	if (value_1 == value_2)
-		return TRUE;
-	return FALSE;
+	return search(&board.search_stack[1]);
 }
 
 /**
@@ -355,6 +462,37 @@ void generate_root_moves(void)
 	zct->root_move_count = next;
 }
 
+/**
+restrict_root_moves():
+If only certain moves were given to be searched, remove every other move from
+the root move list. Moves that aren't legal here are ignored, and if none of
+them are, the list is left alone.
+Created 101926; last modified 101926
+**/
+void restrict_root_moves(void)
+{
+	int next;
+	int x;
+	int y;
+
+	if (zct->search_move_count == 0)
+		return;
+	next = 0;
+	for (x = 0; x < zct->root_move_count; x++)
+	{
+		for (y = 0; y < zct->search_move_count; y++)
+		{
+			if (zct->root_move_list[x].move == zct->search_moves[y])
+			{
+				zct->root_move_list[next++] = zct->root_move_list[x];
+				break;
+			}
+		}
+	}
+	if (next > 0)
+		zct->root_move_count = next;
+}
+
 /**
 check_result():
 Generates legal moves, checks if the game is over, and prints the result if
@@ -47,7 +47,9 @@ void cmd_parse(char *delim);
 
 /* Default protocol */
 void cmd_analyze(void);
+void cmd_aspiration(void);
 void cmd_bench(void);
+void cmd_bitbase(void);
 void cmd_bookc(void);
 void cmd_bookl(void);
 void cmd_bookp(void);
@@ -57,6 +59,8 @@ void cmd_divide(void);
 void cmd_eval(void);
 void cmd_evalparam(void);
 void cmd_exit(void);
+void cmd_extract(void);
+void cmd_featureeval(void);
 void cmd_fen(void);
 void cmd_flip(void);
 void cmd_hash(void);
@@ -68,19 +72,30 @@ void cmd_moves(void);
 #ifdef SMP
 void cmd_mp(void);
 #endif
+void cmd_multipv(void);
 void cmd_new(void);
 void cmd_notation(void);
 void cmd_omin(void);
 void cmd_open(void);
 void cmd_perf(void);
 void cmd_perft(void);
+void cmd_regress(void);
+#ifdef SMP
+void cmd_rootsplit(void);
+#endif
 void cmd_save(void);
+void cmd_searchmoves(void);
 void cmd_setfen(void);
 void cmd_setname(void);
+#ifdef SMP
+void cmd_sharedheuristics(void);
+#endif
 void cmd_sort(void);
 void cmd_source(void);
 void cmd_test(void);
 void cmd_testeval(void);
+void cmd_trace(void);
+void cmd_treestats(void);
 void cmd_tune(void);
 void cmd_uci(void);
 void cmd_verify(void);
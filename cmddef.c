@@ -24,11 +24,17 @@
 #include "eval.h"
 #include "pgn.h"
 #include "smp.h"
+#include "bit.h"
+#include "trace.h"
 
 COMMAND def_commands[] =
 {
 	{ 0, "analyze", "enter analysis mode", 1, cmd_analyze },
+	{ 0, "aspiration", "set the initial aspiration window width at the root, "
+		"or 0 to search with a full window", 0, cmd_aspiration },
 	{ 0, "bench", "benchmark chess search speed", 1, cmd_bench },
+	{ 0, "bitbase", "list the endgame bitbases and probe the current "
+		"position, or generate a bitbase", 1, cmd_bitbase },
 	{ 0, "bookc", "create a book from a pgn file", 1, cmd_bookc },
 	{ 0, "bookl", "load an opening book (ZCT native format)", 0, cmd_bookl },
 	{ 0, "bookp", "probe the current position in the opening book for a move",
@@ -45,6 +51,10 @@ COMMAND def_commands[] =
 	{ 0, "evalparam", "set an evaluation function parameter",
 		1, cmd_evalparam },
 	{ 0, "exit", "exit ZCT", 0, cmd_exit },
+	{ 0, "extract", "extract quiet positions with game results from a pgn "
+		"file, for tuning", 1, cmd_extract },
+	{ 0, "featureeval", "use the feature evaluator, or load/save its weights",
+		1, cmd_featureeval },
 	{ 0, "fen", "print the FEN string for the current position.", 0, cmd_fen },
 	{ 0, "flip", "flip the board position from rank 1 to 8, reversing colors "
 		"to create a symmetric position", 1, cmd_flip },
@@ -65,6 +75,8 @@ COMMAND def_commands[] =
 #ifdef SMP
 	{ 0, "mp", "set the maximum number of processors to use", 1, cmd_mp },
 #endif
+	{ 0, "multipv", "set the number of best lines to search and display",
+		0, cmd_multipv },
 	{ 0, "new", "start a new game", 1, cmd_new },
 	{ 0, "notation", "set the notation for displaying moves in coordinate, "
 		"SAN, or LSAN.", 0, cmd_notation },
@@ -75,14 +87,26 @@ COMMAND def_commands[] =
 	{ 0, "perf", NULL, 1, cmd_perf },
 	{ 0, "perft", NULL, 1, cmd_perft },
 	{ 0, "post", "turn search output on", 0, cmd_post },
+	{ 0, "regress", "run the regression tests", 1, cmd_regress },
+#ifdef SMP
+	{ 0, "rootsplit", "turn the parallel search of root moves on or off",
+		0, cmd_rootsplit },
+#endif
 	{ 0, "save", "save the current game into a PGN file", 0, cmd_save },
 	{ 0, "sd", "set ZCT to think for a certain depth each move", 0, cmd_sd },
+	{ 0, "searchmoves", "only search the given moves in the next search, or "
+		"all moves if none are given", 0, cmd_searchmoves },
 	{ 0, "setboard", "sets up a new FEN position", 1, cmd_setboard },
 	{ 0, "setfen", "sets up a FEN position from a file, given a line number",
 		1, cmd_setfen },
 	{ 0, "setname", "set a supplementary name for the engine, to be used in "
 		"printing ZCT's name. Useful for personality settings.",
 		0, cmd_setname },
+#ifdef SMP
+	{ 0, "sharedheuristics", "turn the sharing of the history, killer, and "
+		"counter move tables between processors on or off", 0,
+		cmd_sharedheuristics },
+#endif
 	{ 0, "sort", "displays all moves for this position in a sorted order "
 		"along with their scores", 0, cmd_sort },
 	{ 0, "source", "read the contents of a file as if they were commands, "
@@ -90,8 +114,12 @@ COMMAND def_commands[] =
 	{ 0, "st", "set ZCT to think for a certain time each move", 0, cmd_st },
 	{ 0, "test", "run ZCT on an EPD test suite", 1, cmd_test },
 	{ 0, "testeval", "test the symmetry of ZCT's eval", 1, cmd_testeval },
-	{ 0, "tune", "Given a pgn file of good quality games, tune the evaluation "
-		"function to best match the moves", 1, cmd_tune },
+	{ 0, "trace", "record the search tree to a file, or summarize a recorded "
+		"trace", 1, cmd_trace },
+	{ 0, "treestats", "turn the tree shape statistics printed after each "
+		"iteration on or off", 0, cmd_treestats },
+	{ 0, "tune", "tune the evaluation to best predict the results of a set of "
+		"positions made by extract", 1, cmd_tune },
 	{ 0, "uci", NULL, 1, cmd_uci },
 	{ 0, "undo", "undoes a move", 1, cmd_undo },
 	{ 0, "verify", NULL, 0, cmd_verify },
@@ -112,6 +140,33 @@ void cmd_analyze(void)
 	initialize_cmds();
 }
 
+/**
+cmd_aspiration():
+Set the initial width of the aspiration window used at the root.
+Created 101926; last modified 101926
+**/
+void cmd_aspiration(void)
+{
+	int n;
+
+	if (cmd_input.arg_count != 2)
+	{
+	 	print("Usage: aspiration width\n");
+		return;
+	}
+	n = atoi(cmd_input.arg[1]);
+	if (n < 0 || n >= MATE)
+	{
+		print("Width must be between 0 and %i.\n", MATE - 1);
+		return;
+	}
+	zct->aspiration_window = n;
+	if (n == 0)
+		print("Aspiration windows off.\n");
+	else
+		print("Aspiration window set at %i.\n", zct->aspiration_window);
+}
+
 /**
 cmd_bench():
 Run the bench() function to test speed.
@@ -122,6 +177,63 @@ void cmd_bench(void)
 	bench();
 }
 
+/**
+cmd_bitbase():
+The "bitbase" command lists the bitbases and probes the current position, or
+generates a bitbase and saves it to a file, from which it is loaded at
+startup.
+Created 101926; last modified 101926
+**/
+void cmd_bitbase(void)
+{
+	char file_name[16];
+	int time;
+	int x;
+	BITBOARD wins;
+	VALUE value;
+	BITBASE *bb;
+
+	if (cmd_input.arg_count == 1)
+	{
+		for (x = 0; x < BITBASE_COUNT; x++)
+			print("%-5s %s\n", bitbase[x].name,
+				bitbase[x].ready ? "ready" : "not generated");
+		if (bitbase_probe(&value))
+			print("Current position: %s\n", value == DRAW ? "draw" :
+				value > DRAW ? "win" : "loss");
+		return;
+	}
+	if (cmd_input.arg_count != 3 || strcmp(cmd_input.arg[1], "gen"))
+	{
+		print("Usage: bitbase [gen name]\n");
+		return;
+	}
+
+	for (x = 0; x < BITBASE_COUNT; x++)
+	{
+		if (!strcmp(cmd_input.arg[2], bitbase[x].name))
+			break;
+	}
+	if (x == BITBASE_COUNT)
+	{
+		print("Unknown bitbase: %s\n", cmd_input.arg[2]);
+		return;
+	}
+	bb = &bitbase[x];
+
+	time = get_time();
+	bitbase_generate(bb);
+	wins = 0;
+	for (x = 0; x < 2 * bb->size / 64; x++)
+		wins += pop_count(bb->table[x]);
+	print("%s: positions=%L wins=%L time=%T\n", bb->name, 2 * bb->size, wins,
+		get_time() - time);
+
+	bitbase_file_name(bb, file_name);
+	if (!bitbase_save(bb, file_name))
+		print("Could not save %s.\n", file_name);
+}
+
 /**
 cmd_bookc():
 The "bookc" command creates a new opening book.
@@ -261,7 +373,7 @@ void cmd_eval(void)
 /**
 cmd_evalparam():
 Set an evaluation parameter.
-Created 020808; last modified 040809
+Created 020808; last modified 101926
 **/
 void cmd_evalparam(void)
 {
@@ -301,7 +413,7 @@ void cmd_evalparam(void)
 			/* Set the value. */
 			value = (VALUE)atoi(cmd_input.arg[2]);
 			*eval_parameter[param].value = value;
-			return;
+			break;
 
 		case 1:
 			count = eval_parameter[param].dimension[0];
@@ -314,7 +426,7 @@ void cmd_evalparam(void)
 				value = (VALUE)atoi(cmd_input.arg[element + 2]);
 				eval_parameter[param].value[element] = value;
 			}
-			return;
+			break;
 
 		case 2:	
 			count = eval_parameter[param].dimension[0] *
@@ -343,9 +455,16 @@ void cmd_evalparam(void)
 					dim_1 = -1;
 				}
 			}
-			return;
+			break;
 	}
 
+	/* The black piece square tables are mirrored from the white ones, and the
+		board keeps incremental material and piece square sums, so set those
+		up again with the new values. */
+	initialize_eval();
+	initialize_bitboards();
+	return;
+
 error:
 	print("Parameter \"%s\" requires %i arguments.\n",
 		eval_parameter[param].name, count);
@@ -361,6 +480,114 @@ void cmd_exit(void)
 	exit(EXIT_SUCCESS);
 }
 
+/**
+cmd_extract():
+The "extract" command writes the quiet positions from a PGN file, with their
+game results, to a file for tuning. The options are:
+fen: write FEN strings with a c9 result opcode instead of packed positions
+minply n: skip the first n plies of each game (default 10)
+margin n: the most the qsearch can differ from the static eval (default 0)
+balance n: skip positions with a material balance over n (default off)
+decisive: skip drawn games
+Created 101926; last modified 101926
+**/
+void cmd_extract(void)
+{
+	char pgn_name[256];
+	char out_name[256];
+	int arg;
+	int min_ply;
+	BOOL fen;
+	BOOL decisive;
+	VALUE margin;
+	VALUE max_balance;
+
+	if (cmd_input.arg_count < 3)
+		goto usage;
+
+	fen = FALSE;
+	decisive = FALSE;
+	min_ply = 10;
+	margin = 0;
+	max_balance = 0;
+	for (arg = 3; arg < cmd_input.arg_count; arg++)
+	{
+		if (!strcmp(cmd_input.arg[arg], "fen"))
+			fen = TRUE;
+		else if (!strcmp(cmd_input.arg[arg], "decisive"))
+			decisive = TRUE;
+		else if (arg + 1 < cmd_input.arg_count &&
+			!strcmp(cmd_input.arg[arg], "minply"))
+			min_ply = atoi(cmd_input.arg[++arg]);
+		else if (arg + 1 < cmd_input.arg_count &&
+			!strcmp(cmd_input.arg[arg], "margin"))
+			margin = atoi(cmd_input.arg[++arg]);
+		else if (arg + 1 < cmd_input.arg_count &&
+			!strcmp(cmd_input.arg[arg], "balance"))
+			max_balance = atoi(cmd_input.arg[++arg]);
+		else
+			goto usage;
+	}
+
+	/* The PGN parser reuses the command input. */
+	strncpy(pgn_name, cmd_input.arg[1], sizeof(pgn_name) - 1);
+	pgn_name[sizeof(pgn_name) - 1] = '\0';
+	strncpy(out_name, cmd_input.arg[2], sizeof(out_name) - 1);
+	out_name[sizeof(out_name) - 1] = '\0';
+
+	zct->protocol = TUNE;
+	initialize_cmds();
+	extract_positions(pgn_name, out_name, fen, min_ply, margin, max_balance,
+		decisive);
+	zct->protocol = DEFAULT;
+	initialize_cmds();
+	return;
+
+usage:
+	print("Usage: extract pgn_file out_file [fen] [minply n] [margin n] "
+		"[balance n] [decisive]\n");
+}
+
+/**
+cmd_featureeval():
+The "featureeval" command switches between the standard evaluation and the
+feature evaluator, and loads or saves the feature weights.
+Created 101926; last modified 101926
+**/
+void cmd_featureeval(void)
+{
+	if (cmd_input.arg_count == 2 && !strcmp(cmd_input.arg[1], "on"))
+		zct->feature_eval = TRUE;
+	else if (cmd_input.arg_count == 2 && !strcmp(cmd_input.arg[1], "off"))
+		zct->feature_eval = FALSE;
+	else if (cmd_input.arg_count == 3 && !strcmp(cmd_input.arg[1], "load"))
+	{
+		if (!load_features(cmd_input.arg[2]))
+		{
+			print("Could not load feature weights from %s.\n",
+				cmd_input.arg[2]);
+			return;
+		}
+	}
+	else if (cmd_input.arg_count == 3 && !strcmp(cmd_input.arg[1], "save"))
+	{
+		if (!save_features(cmd_input.arg[2]))
+			print("Could not save feature weights to %s.\n",
+				cmd_input.arg[2]);
+		return;
+	}
+	else
+	{
+		print("Usage: featureeval on|off|load file_name|save file_name\n");
+		return;
+	}
+	/* The accumulators aren't updated while the feature eval is off, and
+		the weights might have changed. */
+	refresh_features(WHITE);
+	refresh_features(BLACK);
+	print("Feature evaluation %s.\n", zct->feature_eval ? "on" : "off");
+}
+
 /**
 cmd_fen():
 Prints the FEN representation of the current position.
@@ -545,6 +772,31 @@ void cmd_mp(void)
 }
 #endif
 
+/**
+cmd_multipv():
+The "multipv" command sets the number of best lines that are searched with
+exact scores and displayed.
+Created 101926; last modified 101926
+**/
+void cmd_multipv(void)
+{
+	int n;
+
+	if (cmd_input.arg_count != 2)
+	{
+	 	print("Usage: multipv lines\n");
+		return;
+	}
+	n = atoi(cmd_input.arg[1]);
+	if (n < 1 || n > MAX_ROOT_MOVES)
+	{
+		print("Number of lines must be between 1 and %i.\n", MAX_ROOT_MOVES);
+		return;
+	}
+	zct->multi_pv = n;
+	print("Searching %i line%s.\n", n, n > 1 ? "s" : "");
+}
+
 /**
 cmd_new():
 Start a new game.
@@ -674,6 +926,43 @@ void cmd_perft(void)
 	print("moves=%L time=%T\n", nodes, get_time() - time);
 }
 
+/**
+cmd_regress():
+The "regress" command runs the regression tests.
+Created 101926; last modified 101926
+**/
+void cmd_regress(void)
+{
+	regress();
+}
+
+#ifdef SMP
+/**
+cmd_rootsplit():
+Turn the parallel search of root moves on or off. When on, the root moves after
+the first are searched by different processors at the same time.
+Created 101926; last modified 101926
+**/
+void cmd_rootsplit(void)
+{
+	if (cmd_input.arg_count != 2)
+	{
+	 	print("Usage: rootsplit on|off\n");
+		return;
+	}
+	if (!strcmp(cmd_input.arg[1], "on"))
+		zct->root_split = TRUE;
+	else if (!strcmp(cmd_input.arg[1], "off"))
+		zct->root_split = FALSE;
+	else
+	{
+	 	print("Usage: rootsplit on|off\n");
+		return;
+	}
+	print("Root splitting %s.\n", zct->root_split ? "on" : "off");
+}
+#endif
+
 /**
 cmd_save():
 The "save" command saves the current game in PGN format to an external file.
@@ -692,6 +981,35 @@ void cmd_save(void)
 	pgn_save(file_name);
 }
 
+/**
+cmd_searchmoves():
+The "searchmoves" command restricts the next search to the given root moves.
+Created 101926; last modified 101926
+**/
+void cmd_searchmoves(void)
+{
+	MOVE move;
+	int c;
+
+	zct->search_move_count = 0;
+	for (c = 1; c < cmd_input.arg_count; c++)
+	{
+		if (!(move = input_move(cmd_input.arg[c], INPUT_GET_MOVE)))
+		{
+			print("Illegal move: %s\n", cmd_input.arg[c]);
+			zct->search_move_count = 0;
+			return;
+		}
+		if (zct->search_move_count < MAX_ROOT_MOVES)
+			zct->search_moves[zct->search_move_count++] = move;
+	}
+	if (zct->search_move_count == 0)
+		print("Searching all moves.\n");
+	else
+		print("Searching %i move%s.\n", zct->search_move_count,
+			zct->search_move_count > 1 ? "s" : "");
+}
+
 /**
 cmd_setfen():
 The "setfen" command looks at a FEN/EPD file and sets the board to a certain
@@ -758,10 +1076,41 @@ void cmd_setname(void)
 	strncpy(zct->name_string, cmd_input.arg[1], sizeof(zct->name_string));
 }
 
+#ifdef SMP
+/**
+cmd_sharedheuristics():
+Turn the sharing of the history, killer, and counter move tables between
+processors on or off. When off, each processor orders its moves with only what
+it has learned itself. The child processors are restarted to pick up the change.
+Created 101926; last modified 101926
+**/
+void cmd_sharedheuristics(void)
+{
+	if (cmd_input.arg_count != 2)
+	{
+	 	print("Usage: sharedheuristics on|off\n");
+		return;
+	}
+	if (!strcmp(cmd_input.arg[1], "on"))
+		zct->shared_heuristics = TRUE;
+	else if (!strcmp(cmd_input.arg[1], "off"))
+		zct->shared_heuristics = FALSE;
+	else
+	{
+	 	print("Usage: sharedheuristics on|off\n");
+		return;
+	}
+	if (zct->process_count > 1)
+		initialize_smp(zct->process_count);
+	print("Shared move ordering tables %s.\n",
+		zct->shared_heuristics ? "on" : "off");
+}
+#endif
+
 /**
 cmd_sort():
 The "sort" command prints out each move along with its score in sorted order.
-Created 082507; last modified 090608
+Created 082507; last modified 101926
 **/
 void cmd_sort(void)
 {
@@ -775,9 +1124,14 @@ void cmd_sort(void)
 
 	sb.first_move = move_list;
 	sb.next_move = move_list;
+	sb.last_move = move_list;
+	sb.next_bad_cap = move_list;
+	sb.last_bad_cap = move_list;
+	sb.hash_move = NO_MOVE;
 	sb.check = check_squares();
 	sb.select_state = SELECT_HASH_MOVE;
 	sb.ply = 0;
+	evaluate(&sb.eval_block);
 	print("move   score  flags\n");
 	if (flags)
 	{
@@ -875,21 +1229,79 @@ void cmd_testeval(void)
 	test_epd_eval(cmd_input.arg[1]);
 }
 
+/**
+cmd_trace():
+The "trace" command turns the search tree trace on or off, or prints a summary
+of a trace that was recorded earlier. Each processor writes its own file, named
+with the processor number added to the end of the trace name.
+Created 101926; last modified 101926
+**/
+void cmd_trace(void)
+{
+	if (cmd_input.arg_count == 3 && !strcmp(cmd_input.arg[1], "on"))
+	{
+		if (trace_start(cmd_input.arg[2]))
+			print("Tracing to %s.\n", cmd_input.arg[2]);
+		else
+			print("Could not open trace file for %s.\n", cmd_input.arg[2]);
+	}
+	else if (cmd_input.arg_count == 2 && !strcmp(cmd_input.arg[1], "off"))
+	{
+		trace_stop();
+		print("Tracing off.\n");
+	}
+	else if (cmd_input.arg_count == 3 &&
+		!strcmp(cmd_input.arg[1], "summary"))
+		trace_summary(cmd_input.arg[2]);
+	else
+		print("Usage: trace on trace_name | trace off | "
+			"trace summary trace_name\n");
+}
+
+/**
+cmd_treestats():
+Turn the tree shape statistics on or off. When on, a line with the effective
+branching factor, first move cutoff rate, hash cutoff rate, and extension
+counts is printed after each iteration.
+Created 101926; last modified 101926
+**/
+void cmd_treestats(void)
+{
+	if (cmd_input.arg_count != 2)
+	{
+	 	print("Usage: treestats on|off\n");
+		return;
+	}
+	if (!strcmp(cmd_input.arg[1], "on"))
+		zct->tree_stats = TRUE;
+	else if (!strcmp(cmd_input.arg[1], "off"))
+		zct->tree_stats = FALSE;
+	else
+	{
+	 	print("Usage: treestats on|off\n");
+		return;
+	}
+	print("Tree statistics %s.\n", zct->tree_stats ? "on" : "off");
+}
+
 /**
 cmd_tune():
-Takes a PGN filename and tunes the evaluation to match the moves made.
-Created 101907; last modified 101907
+The "tune" command tunes the evaluation on a binary file of positions written
+by "extract", and writes the new parameters out as evalparam commands.
+Created 101907; last modified 101926
 **/
 void cmd_tune(void)
 {
-	if (cmd_input.arg_count != 2)
+	if (cmd_input.arg_count < 2 || cmd_input.arg_count > 4)
 	{
-		print("Usage: tune file_name\n");
+		print("Usage: tune bin_file [iterations [ini_file]]\n");
 		return;
 	}
 	zct->protocol = TUNE;
 	initialize_cmds();
-	tune_pgn(cmd_input.arg[1]);
+	tune_eval(cmd_input.arg[1], cmd_input.arg_count > 2 ?
+		atoi(cmd_input.arg[2]) : 1000, cmd_input.arg_count > 3 ?
+		cmd_input.arg[3] : "tune.ini");
 	zct->protocol = DEFAULT;
 	initialize_cmds();
 }
@@ -897,7 +1309,7 @@ void cmd_tune(void)
 /**
 cmd_uci():
 Switches to UCI mode. Loads the UCI command set into the command table.
-Created 101607; last modified 042808
+Created 101607; last modified 101926
 **/
 void cmd_uci(void)
 {
@@ -907,6 +1319,9 @@ void cmd_uci(void)
 	initialize_cmds();
 	print("id name %s\n", zct_version_string());
 	print("id author Zach Wegner\n");
+	print("option name MultiPV type spin default 1 min 1 max %i\n",
+		MAX_ROOT_MOVES);
+	print("option name FeatureEval type check default false\n");
 	print("uciok\n");
 }
 
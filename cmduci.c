@@ -21,6 +21,7 @@
 #include "functions.h"
 #include "globals.h"
 #include "cmd.h"
+#include "eval.h"
 
 COMMAND uci_commands[] =
 {
@@ -106,10 +107,46 @@ void cmd_position(void)
 /**
 cmd_setoption():
 The "setoption" command sets various parameters that ZCT may or may not have.
-Created 101607; last modified 101607
+Created 101607; last modified 101926
 **/
 void cmd_setoption(void)
 {
+	char name[256];
+	char *value;
+	int c;
+
+	/* Gather the option name, which can have spaces in it, and the value. */
+	strcpy(name, "");
+	value = NULL;
+	for (c = 1; c < cmd_input.arg_count; c++)
+	{
+		if (!strcmp(cmd_input.arg[c], "name"))
+			continue;
+		else if (!strcmp(cmd_input.arg[c], "value"))
+		{
+			if (c + 1 < cmd_input.arg_count)
+				value = cmd_input.arg[c + 1];
+			break;
+		}
+		if (strlen(name) + strlen(cmd_input.arg[c]) + 2 >= sizeof(name))
+			break;
+		if (name[0])
+			strcat(name, " ");
+		strcat(name, cmd_input.arg[c]);
+	}
+
+	if (!strcmp(name, "MultiPV") && value != NULL)
+	{
+		c = atoi(value);
+		if (c >= 1 && c <= MAX_ROOT_MOVES)
+			zct->multi_pv = c;
+	}
+	else if (!strcmp(name, "FeatureEval") && value != NULL)
+	{
+		zct->feature_eval = !strcmp(value, "true");
+		refresh_features(WHITE);
+		refresh_features(BLACK);
+	}
 }
 
 /**
@@ -126,20 +163,28 @@ void cmd_uci_stop(void)
 /**
 cmd_go():
 The "go" command makes ZCT start searching. All parameters of searching are within this one command.
-Created 101607; last modified 050108
+Created 101607; last modified 101926
 **/
 void cmd_uci_go(void)
 {
+	MOVE move;
 	int c;
 
 	zct->zct_side = board.side_tm;
+	zct->search_move_count = 0;
 	set_time_control(0, 0, 0);
 	for (c = 1; c < cmd_input.arg_count; c++)
 	{
-		/* "moves" sets ZCT to only search certain root moves. */
-		if (!strcmp(cmd_input.arg[c], "moves"))
+		/* "searchmoves" sets ZCT to only search certain root moves. */
+		if (!strcmp(cmd_input.arg[c], "searchmoves"))
 		{
-			/* Should this be implemented? */
+			while (c + 1 < cmd_input.arg_count &&
+				(move = input_move(cmd_input.arg[c + 1], INPUT_GET_MOVE)) &&
+				zct->search_move_count < MAX_ROOT_MOVES)
+			{
+				zct->search_moves[zct->search_move_count++] = move;
+				c++;
+			}
 		}
 		else if (!strcmp(cmd_input.arg[c], "wtime"))
 		{
@@ -22,11 +22,14 @@
 #include "globals.h"
 #include "eval.h"
 #include "bit.h"
+#include "profile.h"
 
 /* evaluation globals */
 BITBOARD attack_set[2][6];
 BITBOARD good_squares[2];
+BITBOARD exact_attacks[2];
 PHASE phase;
+THREAD_LOCAL BOOL eval_batch_mode = FALSE;
 
 /* Color-independent fill functions */
 BITBOARD (*fill_forward[2])(BITBOARD g, BITBOARD p) =
@@ -63,38 +66,16 @@ VALUE interpolate(VALUE value, PHASE phase, PHASE target)
 }
 
 /**
-evaluate():
-Evaluates the board position.
-Created 071505; last modified 091608
+game_phase():
+Determines the game phase, from OPENING_PHASE to ENDGAME_PHASE. The piece
+counts are kept incrementally.
+Created 101926; last modified 101926
 **/
-VALUE evaluate(EVAL_BLOCK *eval_block)
+PHASE game_phase(void)
 {
 	int r;
-	BITBOARD pieces;
-	COLOR color;
-	EVAL_HASH_ENTRY *eval_hash_entry;
-	PIECE piece;
-	SQUARE square;
-	VALUE eval[2];
-	VALUE eval_temp;
-	VALUE eval_temp_2;
+	PHASE phase;
 
-	/* Look up this position in the eval hash table. */
-	eval_hash_entry = &eval_hash_table[board.hashkey % zct->eval_hash_size];
-	zct->eval_hash_probes++;
-	if (eval_hash_entry && eval_hash_entry->hashkey == board.hashkey)
-	{
-		zct->eval_hash_hits++;
-		DEBUG_EVAL(print("eval hash hit = %V\n", eval_hash_entry->eval.eval));
-		*eval_block = eval_hash_entry->eval;
-		return eval_hash_entry->eval.eval[board.side_tm] -
-			eval_hash_entry->eval.eval[board.side_ntm];
-	}
-
-	eval[WHITE] = 0;
-	eval[BLACK] = 0;
-
-	/* Determine the game phase. */
 	r = 0;
 	/* 16 -- piece count */
 	r += board.piece_count[WHITE] + board.piece_count[BLACK];
@@ -105,11 +86,12 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 	/* 16 -- pawn count */
 	r += board.pawn_count[WHITE] + board.pawn_count[BLACK];
 	/* 16 -- minor piece count */
-	r += 2 * MIN(pop_count(board.piece_bb[KNIGHT] | board.piece_bb[BISHOP]), 8);
+	r += 2 * MIN(board.piece_type_count[KNIGHT] +
+		board.piece_type_count[BISHOP], 8);
 	/* 16 -- rook count */
-	r += 4 * MIN(pop_count(board.piece_bb[ROOK]), 4);
+	r += 4 * MIN(board.piece_type_count[ROOK], 4);
 	/* 16 -- queen count */
-	r += 8 * MIN(pop_count(board.piece_bb[QUEEN]), 2);
+	r += 8 * MIN(board.piece_type_count[QUEEN], 2);
 	/* 32 -- development: occupancy of first two ranks */
 	r += 2*pop_count(board.occupied_bb &
 		(MASK_RANK(RANK_1)/* | MASK_RANK(RANK_2) |
@@ -117,6 +99,69 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 
 	phase = MAX_PHASE - r;
 	phase = MAX(0, MIN(MAX_PHASE, phase));
+	return phase;
+}
+
+/**
+evaluate():
+Evaluates the board position.
+Created 071505; last modified 101926
+**/
+VALUE evaluate(EVAL_BLOCK *eval_block)
+{
+	return evaluate_lazy(eval_block, -MATE, MATE);
+}
+
+/**
+evaluate_lazy():
+Evaluates the board position, given a window. If the cheap terms (material,
+piece square tables, development, and pawn structure) are more than
+lazy_eval_margin outside of the window, the rest of the evaluation is skipped
+and the cheap score is returned. Such scores are not stored in the eval hash
+table, and the eval block only has the phase and the partial scores.
+Created 101926; last modified 101926
+**/
+VALUE evaluate_lazy(EVAL_BLOCK *eval_block, VALUE alpha, VALUE beta)
+{
+	COLOR color;
+	EVAL_HASH_ENTRY *eval_hash_entry;
+	PIECE piece;
+	VALUE eval[2];
+	VALUE eval_temp;
+	VALUE eval_temp_2;
+	PROFILE_DECLARE(profile_start)
+
+	PROFILE_START(profile_start);
+	/* The feature evaluator is cheap and keeps its own state. */
+	if (zct->feature_eval)
+		PROFILE_RETURN(PROFILE_EVALUATE, profile_start,
+			evaluate_features(eval_block));
+
+	/* Look up this position in the eval hash table. Batch evaluations
+		don't use the hash tables or statistics, so they can run on any
+		process without disturbing it. */
+	eval_hash_entry = NULL;
+	if (!eval_batch_mode)
+	{
+		eval_hash_entry =
+			&eval_hash_table[board.hashkey % zct->eval_hash_size];
+		zct->eval_hash_probes++;
+	}
+	if (eval_hash_entry && eval_hash_entry->hashkey == board.hashkey)
+	{
+		zct->eval_hash_hits++;
+		DEBUG_EVAL(print("eval hash hit = %V\n", eval_hash_entry->eval.eval));
+		*eval_block = eval_hash_entry->eval;
+		PROFILE_RETURN(PROFILE_EVALUATE, profile_start,
+			eval_hash_entry->eval.eval[board.side_tm] -
+			eval_hash_entry->eval.eval[board.side_ntm]);
+	}
+
+	eval[WHITE] = 0;
+	eval[BLACK] = 0;
+
+	/* Determine the game phase. */
+	phase = game_phase();
 	eval_block->phase = phase;
 	ASSERT(phase >= 0 && phase <= MAX_PHASE);
 	DEBUG_EVAL(print("phase = %i/%i\n", phase, MAX_PHASE));
@@ -132,18 +177,10 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 	/* First pass: evaluate simple terms, material and development */
 	for (color = WHITE; color <= BLACK; color++)
 	{
-		/* Material value and piece square tables. */
-		pieces = board.color_bb[color] & ~board.piece_bb[KING];
-		eval_temp = board.material[color];
-		eval_temp_2 = 0;
-		while (pieces)
-		{
-			square = first_square(pieces);
-			CLEAR_BIT(pieces, square);
-			piece = board.piece[square];
-			eval_temp += piece_square_value[color][piece][square];
-			eval_temp_2 += piece_endgame_value[piece];
-		}
+		/* Material value and piece square tables, which are updated
+			incrementally in make_move(). */
+		eval_temp = board.material[color] + board.psq_opening[color];
+		eval_temp_2 = board.psq_endgame[color];
 		DEBUG_EVAL(print("piece square[%C](op,eg) = %V %V\n", color,
 			eval_temp, eval_temp_2));
 
@@ -168,6 +205,32 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 	DEBUG_EVAL(print("pawns = %V\n", eval_temp));
 	eval[board.side_tm] += eval_temp;
 
+	/* Side to move bonus. This goes in before the lazy exit, so that the lazy
+		scores in the eval block include it too. */
+	eval[board.side_tm] += interpolate(side_tm_value, phase, 0);
+
+	/* Lazy exit: the rest of the evaluation can't bring the score back into
+		the window. */
+	eval_temp = eval[board.side_tm] - eval[board.side_ntm];
+	if (eval_temp - lazy_eval_margin >= beta ||
+		eval_temp + lazy_eval_margin <= alpha)
+	{
+		if (!eval_batch_mode)
+			zct->lazy_evals++;
+		for (color = WHITE; color <= BLACK; color++)
+		{
+			eval_block->eval[color] = eval[color];
+			eval_block->king_safety[color] = 0;
+			eval_block->passed_pawn[color] = 0;
+			eval_block->good_squares[color] = 0;
+			eval_block->attacks[color] = 0;
+		}
+		eval_block->full_eval = eval_temp;
+		PROFILE_RETURN(PROFILE_EVALUATE, profile_start, eval_temp);
+	}
+	if (!eval_batch_mode)
+		zct->full_evals++;
+
 	/* Second pass: evaluate more complex terms */
 	for (color = WHITE; color <= BLACK; color++)
 	{
@@ -179,6 +242,8 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 
 	/* Third pass: evaluate terms based on previous calculations,
 		primarily the attack tables. */
+	if (board.pawn_entry.passed_pawns)
+		find_exact_attacks();
 	for (color = WHITE; color <= BLACK; color++)
 	{
 		/* Evaluate king safety. */
@@ -197,9 +262,6 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 		eval[color] += eval_temp;
 	}
 
-	/* Side to move bonus. */
-	eval[board.side_tm] += interpolate(side_tm_value, phase, 0);
-
 	/* Final score */
 	for (color = WHITE; color <= BLACK; color++)
 	{
@@ -209,6 +271,13 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 
 		/* Stuff some eval data into the evaluation block. */
 		eval_block->good_squares[color] = good_squares[color];
+
+		/* Save the attack maps, so that move ordering and generation
+			don't have to recompute them at this node. */
+		eval_block->attacks[color] = board.pawn_entry.pawn_attacks[color] |
+			attack_set[color][KNIGHT] | attack_set[color][BISHOP] |
+			attack_set[color][ROOK] | attack_set[color][QUEEN] |
+			king_moves_bb[board.king_square[color]];
 	}
 
 	/* Final evaluation. */
@@ -216,8 +285,11 @@ VALUE evaluate(EVAL_BLOCK *eval_block)
 
 	/* Store the evaluation in the hash table. */
 	eval_block->full_eval = eval_temp;
-	eval_hash_entry->hashkey = board.hashkey;
-	eval_hash_entry->eval = *eval_block;
+	if (eval_hash_entry != NULL)
+	{
+		eval_hash_entry->hashkey = board.hashkey;
+		eval_hash_entry->eval = *eval_block;
+	}
 
-	return eval_temp;
+	PROFILE_RETURN(PROFILE_EVALUATE, profile_start, eval_temp);
 }
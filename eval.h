@@ -30,6 +30,10 @@
 #define DEBUG_EVAL(x)
 #endif
 
+/* The number of king positions that the feature evaluator has separate
+	weights for. */
+#define FEATURE_BUCKETS		(4)
+
 typedef struct
 {
 	char *name;
@@ -73,6 +77,7 @@ extern VALUE king_bishop_square_value[64];
 extern VALUE king_endgame_square_value[64];
 /* miscellaneous terms */
 extern VALUE side_tm_value;
+extern VALUE lazy_eval_margin;
 /* masks, data, etc. */
 extern BITBOARD development_mask[2];
 extern BITBOARD trapped_rook_mask[2][8];
@@ -84,7 +89,11 @@ extern EVAL_PARAMETER eval_parameter[];
 /* Some evaluation data, to be used between the various evaluation files. */
 extern BITBOARD attack_set[2][6];
 extern BITBOARD good_squares[2];
+extern BITBOARD exact_attacks[2];
+extern short feature_weight_table[FEATURE_BUCKETS][2][6][64][2];
+extern short (*feature_weight)[2][6][64][2];
 extern PHASE phase;
+extern THREAD_LOCAL BOOL eval_batch_mode;
 
 /* Color-independent fill functions */
 extern BITBOARD (*fill_forward[2])(BITBOARD g, BITBOARD p);
@@ -102,6 +111,7 @@ static const SQ_FILE shelter_file[2][2] =
 
 /* eval.c */
 VALUE interpolate(VALUE opening, PHASE phase, PHASE target);
+PHASE game_phase(void);
 VALUE evaluate_knights(COLOR color);
 VALUE evaluate_bishops(COLOR color);
 VALUE evaluate_rooks(COLOR color);
@@ -111,13 +121,30 @@ VALUE evaluate_mobility(BITBOARD attacks, PIECE piece, COLOR color,
 VALUE evaluate_endgame(COLOR color);
 VALUE evaluate_king_safety(EVAL_BLOCK *eval_block, COLOR color);
 
+/* evalfeat.c */
+int feature_bucket(COLOR color);
+void initialize_features(void);
+void refresh_features(COLOR color);
+void update_feature(PIECE piece, COLOR color, SQUARE square, int sign);
+void update_features(MOVE move, PIECE piece, PIECE cap);
+VALUE evaluate_features(EVAL_BLOCK *eval_block);
+BOOL load_features(char *file_name);
+BOOL save_features(char *file_name);
+
 /* evalinit.c */
 void initialize_params(EVAL_PARAMETER *param);
 void copy_params(EVAL_PARAMETER *from, EVAL_PARAMETER *to);
 void free_params(EVAL_PARAMETER *param);
-void print_params(EVAL_PARAMETER *param);
+int param_size(EVAL_PARAMETER *param);
+int get_param_values(VALUE *values);
+void set_param_values(VALUE *values);
+void sprint_param(char *string, int max_length, EVAL_PARAMETER *param);
+BOOL save_params(EVAL_PARAMETER *param, char *file_name);
 
 /* evalpawns.c */
+void find_exact_attacks(void);
+int passed_pawn_path(SQUARE square, COLOR color);
+int passed_pawn_path_scalar(SQUARE square, COLOR color);
 VALUE evaluate_pawns(void);
 VALUE evaluate_passed_pawns(EVAL_BLOCK *eval_block, COLOR color);
 
@@ -0,0 +1,155 @@
+/** ZCT/evalbatch.c--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+#include "functions.h"
+#include "globals.h"
+#include "eval.h"
+#include "smp.h"
+
+/**
+batch_value():
+Returns the value of the position on the board for a batch evaluation of the
+given type.
+Created 101926; last modified 101926
+**/
+VALUE batch_value(BATCH_TYPE type)
+{
+	EVAL_BLOCK eval_block;
+
+	if (type == BATCH_QSEARCH)
+		return qsearch_value();
+	return evaluate(&eval_block);
+}
+
+/**
+evaluate_batch():
+Evaluates an array of packed positions, storing the static eval (or the
+qsearch value, for BATCH_QSEARCH) of each one, from the side to move's point
+of view, in score[]. The eval and pawn hash tables and the statistics in zct
+aren't touched by static evals, and the board is restored afterwards, so this
+can be called at any time outside of a search. With more than one processor,
+the idle children are woken up to help.
+Created 101926; last modified 101926
+**/
+void evaluate_batch(PACKED_POS *pos, VALUE *score, int count, BATCH_TYPE type)
+{
+	BOARD *saved_board;
+	int x;
+#ifdef SMP
+	int n;
+	int p;
+#endif
+
+	if ((saved_board = (BOARD *)malloc(sizeof(BOARD))) == NULL)
+		fatal_error("fatal error: could not allocate board");
+	*saved_board = board;
+	eval_batch_mode = TRUE;
+
+#ifdef SMP
+	if (zct->process_count > 1)
+	{
+		/* The children have their own copies of the eval parameters, which
+			might be out of date. */
+		if (get_param_values(NULL) > EVAL_BATCH_PARAMS)
+			fatal_error("fatal error: too many eval parameters");
+		get_param_values(smp_data->batch_param);
+		smp_data->batch_type = type;
+
+		for (x = 0; x < count; x += n)
+		{
+			n = MIN(count - x, EVAL_BATCH_SIZE);
+			memcpy(smp_data->batch_pos, pos + x, n * sizeof(PACKED_POS));
+			smp_data->batch_count = n;
+			smp_data->batch_next = 0;
+			smp_data->batch_done = 0;
+
+			/* Wake the children up, pitch in ourselves, and then wait for
+				the stragglers. */
+			for (p = 1; p < zct->process_count; p++)
+			{
+				make_active(p);
+				smp_tell(p, SMP_EVAL, 0);
+			}
+			evaluate_batch_work();
+			while (smp_data->batch_done < n)
+				;
+			for (p = 1; p < zct->process_count; p++)
+				make_idle(p);
+
+			memcpy(score + x, smp_data->batch_score, n * sizeof(VALUE));
+		}
+	}
+	else
+#endif
+	{
+		for (x = 0; x < count; x++)
+		{
+			unpack_position(&pos[x]);
+			score[x] = batch_value(type);
+		}
+	}
+
+	eval_batch_mode = FALSE;
+	board = *saved_board;
+	free(saved_board);
+}
+
+#ifdef SMP
+/**
+evaluate_batch_work():
+Grabs chunks of positions from the shared batch and evaluates them, until
+there are none left. Each processor unpacks the positions into its own board,
+so nothing here is shared except the positions, scores, and eval parameters.
+Created 101926; last modified 101926
+**/
+void evaluate_batch_work(void)
+{
+	int start;
+	int end;
+	int x;
+
+	if (board.id != 0)
+		set_param_values(smp_data->batch_param);
+
+	eval_batch_mode = TRUE;
+	while (TRUE)
+	{
+		LOCK(smp_data->batch_lock);
+		start = smp_data->batch_next;
+		end = MIN(start + EVAL_BATCH_CHUNK, smp_data->batch_count);
+		smp_data->batch_next = end;
+		UNLOCK(smp_data->batch_lock);
+
+		if (start >= end)
+			break;
+
+		for (x = start; x < end; x++)
+		{
+			unpack_position(&smp_data->batch_pos[x]);
+			smp_data->batch_score[x] = batch_value(smp_data->batch_type);
+		}
+
+		LOCK(smp_data->batch_lock);
+		smp_data->batch_done += end - start;
+		UNLOCK(smp_data->batch_lock);
+	}
+	eval_batch_mode = FALSE;
+}
+#endif
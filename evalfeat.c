@@ -0,0 +1,258 @@
+/** ZCT/evalfeat.c--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+#include "functions.h"
+#include "globals.h"
+#include "eval.h"
+#include "bit.h"
+
+/* The feature evaluator: every piece on the board is a feature, indexed by
+	the king bucket of the side whose point of view we're taking, whether the
+	piece is friendly or not, the piece type, and the square (flipped for
+	black). The score from each side's point of view is just the sum of the
+	weights of its features, so it is kept incrementally in the board. The
+	weights are in shared memory when there are multiple processors, so that
+	loading them changes them for everyone. */
+short feature_weight_table[FEATURE_BUCKETS][2][6][64][2];
+short (*feature_weight)[2][6][64][2];
+
+/**
+feature_bucket():
+Returns the king bucket for the given side: the king's half of the board
+(queen side or king side) and whether it is still on its first two ranks.
+Created 101926; last modified 101926
+**/
+int feature_bucket(COLOR color)
+{
+	SQUARE square;
+
+	square = SQ_FLIP_COLOR(board.king_square[color], color);
+	return (FILE_OF(square) >= FILE_E) | (RANK_OF(square) >= RANK_3) << 1;
+}
+
+/**
+initialize_features():
+Sets the feature weights from the material and piece square values of the
+standard evaluation, so that the feature evaluator starts out as a sensible
+material+PST eval. All of the king buckets start out the same.
+Created 101926; last modified 101926
+**/
+void initialize_features(void)
+{
+	int bucket;
+	PIECE piece;
+	SQUARE square;
+
+	for (bucket = 0; bucket < FEATURE_BUCKETS; bucket++)
+	{
+		for (piece = PAWN; piece <= KING; piece++)
+		{
+			for (square = A1; square < OFF_BOARD; square++)
+			{
+				/* Kings aren't counted as material, just like evaluate(). */
+				if (piece == KING)
+				{
+					feature_weight[bucket][0][piece][square][0] = 0;
+					feature_weight[bucket][0][piece][square][1] = 0;
+				}
+				else
+				{
+					feature_weight[bucket][0][piece][square][0] =
+						piece_value[piece] +
+						piece_square_value[WHITE][piece][square];
+					feature_weight[bucket][0][piece][square][1] =
+						piece_endgame_value[piece];
+				}
+				/* Enemy pieces are seen from the other side of the board. */
+				feature_weight[bucket][1][piece][SQ_FLIP(square)][0] =
+					-feature_weight[bucket][0][piece][square][0];
+				feature_weight[bucket][1][piece][SQ_FLIP(square)][1] =
+					-feature_weight[bucket][0][piece][square][1];
+			}
+		}
+	}
+}
+
+/**
+refresh_features():
+Recomputes the feature accumulator for the given side's point of view from
+scratch. This is needed when the king changes buckets.
+Created 101926; last modified 101926
+**/
+void refresh_features(COLOR color)
+{
+	int bucket;
+	BITBOARD pieces;
+	SQUARE square;
+	SQUARE rel_square;
+
+	bucket = feature_bucket(color);
+	board.feature_acc[color][0] = 0;
+	board.feature_acc[color][1] = 0;
+	pieces = board.occupied_bb;
+	FOR_BB(square, pieces)
+	{
+		rel_square = SQ_FLIP_COLOR(square, color);
+		board.feature_acc[color][0] += feature_weight[bucket]
+			[board.color[square] != color][board.piece[square]][rel_square][0];
+		board.feature_acc[color][1] += feature_weight[bucket]
+			[board.color[square] != color][board.piece[square]][rel_square][1];
+	}
+}
+
+/**
+update_feature():
+Adds (sign = 1) or removes (sign = -1) a piece from both accumulators.
+Created 101926; last modified 101926
+**/
+void update_feature(PIECE piece, COLOR color, SQUARE square, int sign)
+{
+	int bucket;
+	COLOR view;
+	SQUARE rel_square;
+
+	for (view = WHITE; view <= BLACK; view++)
+	{
+		bucket = feature_bucket(view);
+		rel_square = SQ_FLIP_COLOR(square, view);
+		board.feature_acc[view][0] += sign *
+			feature_weight[bucket][color != view][piece][rel_square][0];
+		board.feature_acc[view][1] += sign *
+			feature_weight[bucket][color != view][piece][rel_square][1];
+	}
+}
+
+/**
+update_features():
+Updates the feature accumulators after a move has been made on the board,
+but before the side to move has been switched. If the king changed buckets,
+that side's accumulator is recomputed, which also covers the other changes.
+Created 101926; last modified 101926
+**/
+void update_features(MOVE move, PIECE piece, PIECE cap)
+{
+	int bucket;
+	COLOR color;
+	SQUARE from;
+	SQUARE to;
+
+	color = board.side_tm;
+	from = MOVE_FROM(move);
+	to = MOVE_TO(move);
+
+	update_feature(piece, color, from, -1);
+	update_feature(MOVE_PROMOTE(move) ? MOVE_PROMOTE(move) : piece, color, to,
+		1);
+	if (cap != EMPTY)
+		update_feature(cap, COLOR_FLIP(color), to, -1);
+	/* En passant: a pawn moved diagonally without capturing anything. */
+	else if (piece == PAWN && FILE_OF(from) != FILE_OF(to))
+		update_feature(PAWN, COLOR_FLIP(color), to - pawn_step[color], -1);
+
+	if (piece == KING)
+	{
+		/* Castling */
+		if (ABS(to - from) == 2)
+		{
+			update_feature(ROOK, color, to > from ? from + 3 : from - 4, -1);
+			update_feature(ROOK, color, to > from ? from + 1 : from - 1, 1);
+		}
+		/* The king square has already been updated, so the updates above
+			for our side used the new bucket. That's only right if the bucket
+			didn't change. */
+		bucket = feature_bucket(color);
+		board.king_square[color] = from;
+		if (bucket != feature_bucket(color))
+		{
+			board.king_square[color] = to;
+			refresh_features(color);
+		}
+		board.king_square[color] = to;
+	}
+}
+
+/**
+evaluate_features():
+Evaluates the position with the feature weights. The accumulator for the side
+to move already has the sum of all the weights, so we just have to scale it
+by the game phase.
+Created 101926; last modified 101926
+**/
+VALUE evaluate_features(EVAL_BLOCK *eval_block)
+{
+	COLOR color;
+	VALUE eval;
+
+	phase = game_phase();
+	eval = interpolate(board.feature_acc[board.side_tm][0], phase,
+		OPENING_PHASE) + interpolate(board.feature_acc[board.side_tm][1],
+		phase, ENDGAME_PHASE) + interpolate(side_tm_value, phase, 0);
+
+	eval_block->phase = phase;
+	for (color = WHITE; color <= BLACK; color++)
+	{
+		eval_block->king_safety[color] = 0;
+		eval_block->passed_pawn[color] = 0;
+		eval_block->good_squares[color] = 0;
+		eval_block->attacks[color] = 0;
+	}
+	eval_block->eval[board.side_tm] = eval;
+	eval_block->eval[board.side_ntm] = 0;
+	eval_block->full_eval = eval;
+
+	return eval;
+}
+
+/**
+load_features():
+Loads the feature weights from a binary file, as written by save_features().
+Returns TRUE on success.
+Created 101926; last modified 101926
+**/
+BOOL load_features(char *file_name)
+{
+	FILE *file;
+	BOOL r;
+
+	if ((file = fopen(file_name, "rb")) == NULL)
+		return FALSE;
+	r = (fread(feature_weight, sizeof(feature_weight_table), 1, file) == 1);
+	fclose(file);
+	if (!r)
+		initialize_features();
+	return r;
+}
+
+/**
+save_features():
+Saves the feature weights to a binary file. Returns TRUE on success.
+Created 101926; last modified 101926
+**/
+BOOL save_features(char *file_name)
+{
+	FILE *file;
+	BOOL r;
+
+	if ((file = fopen(file_name, "wb")) == NULL)
+		return FALSE;
+	r = (fwrite(feature_weight, sizeof(feature_weight_table), 1, file) == 1);
+	fclose(file);
+	return r;
+}
@@ -205,6 +205,10 @@ VALUE king_endgame_square_value[64] =
 
 VALUE side_tm_value = 10; /* XXX test */
 
+/* The most that the terms after pawn structure are trusted to change the
+	score by. Larger differences do happen (king safety), but rarely. */
+VALUE lazy_eval_margin = 500;
+
 BITBOARD development_mask[2];
 BITBOARD trapped_rook_mask[2][8];
 
@@ -260,6 +264,8 @@ EVAL_PARAMETER eval_parameter[] =
 		(VALUE *)king_endgame_square_value,		1, { 64, 0 } },
 	{ "Side To Move Value",
 		(VALUE *)&side_tm_value,				0, { 0, 0 } },
+	{ "Lazy Eval Margin",
+		(VALUE *)&lazy_eval_margin,				0, { 0, 0 } },
 	{ NULL,
 		NULL,									0, { 0, 0 } }
 };
@@ -378,37 +384,116 @@ void copy_params(EVAL_PARAMETER *from, EVAL_PARAMETER *to)
 }
 
 /**
-print_params():
-Given a set of eval parameters, print out each value. This is useful after
-they have been modified by the program, perhaps by autotuning.
-Created 101907; last modified 051709
+param_size():
+Returns the number of values in an eval parameter.
+Created 101926; last modified 101926
+**/
+int param_size(EVAL_PARAMETER *param)
+{
+	if (param->dimensions == 0)
+		return 1;
+	else if (param->dimensions == 1)
+		return param->dimension[0];
+	return param->dimension[0] * param->dimension[1];
+}
+
+/**
+get_param_values():
+Copies every value of the real eval parameters, in order, into one flat array,
+and returns the number of values. If values is NULL, the values are only
+counted.
+Created 101926; last modified 101926
+**/
+int get_param_values(VALUE *values)
+{
+	int count;
+	int p;
+	int x;
+
+	count = 0;
+	for (p = 0; eval_parameter[p].value != NULL; p++)
+	{
+		for (x = 0; x < param_size(&eval_parameter[p]); x++, count++)
+			if (values != NULL)
+				values[count] = eval_parameter[p].value[x];
+	}
+	return count;
+}
+
+/**
+set_param_values():
+Sets the real eval parameters from a flat array, as filled in by
+get_param_values(). The derived evaluation data is then set up again.
+Created 101926; last modified 101926
 **/
-void print_params(EVAL_PARAMETER *param)
+void set_param_values(VALUE *values)
+{
+	int count;
+	int p;
+	int x;
+
+	count = 0;
+	for (p = 0; eval_parameter[p].value != NULL; p++)
+	{
+		for (x = 0; x < param_size(&eval_parameter[p]); x++, count++)
+			eval_parameter[p].value[x] = values[count];
+	}
+	initialize_eval();
+}
+
+/**
+sprint_param():
+Prints an eval parameter into a string, as an evalparam command that can be
+read back in from ZCT.ini. Two-dimensional parameters are kept on one line,
+with a comma after each row.
+Created 101926; last modified 101926
+**/
+void sprint_param(char *string, int max_length, EVAL_PARAMETER *param)
 {
 	int x;
 	int y;
 
-	for (; param->name != NULL; param++)
+	sprint(string, max_length, "evalparam \"%s\"", param->name);
+	if (param->dimensions < 2)
 	{
-		print("evalparam \"%s\"", param->name);
-		if (param->dimensions == 0)
-			print(" %i\n", *param->value);
-		else if (param->dimensions == 1)
-		{
-			for (x = 0; x < param->dimension[0]; x++)
-				print(" %i", param->value[x]);
-			print("\n");
-		}
-		else
+		for (x = 0; x < param_size(param); x++)
+			sprint(string + strlen(string), max_length - strlen(string),
+				" %i", param->value[x]);
+	}
+	else
+	{
+		for (x = 0; x < param->dimension[0]; x++)
 		{
-			for (x = 0; x < param->dimension[0]; x++)
-			{
-				for (y = 0; y < param->dimension[1]; y++)
-					print(" %i", param->value[x * param->dimension[1] + y]);
-				if (x < param->dimension[0] - 1)
-					print(", \\\n");
-			}
-			print("\n");
+			for (y = 0; y < param->dimension[1]; y++)
+				sprint(string + strlen(string), max_length - strlen(string),
+					" %i", param->value[x * param->dimension[1] + y]);
+			if (x < param->dimension[0] - 1)
+				sprint(string + strlen(string), max_length - strlen(string),
+					",");
 		}
 	}
+	sprint(string + strlen(string), max_length - strlen(string), "\n");
+}
+
+/**
+save_params():
+Writes a set of eval parameters to a file as evalparam commands, so that the
+file can be pasted into ZCT.ini or sourced.
+Returns TRUE on success.
+Created 101926; last modified 101926
+**/
+BOOL save_params(EVAL_PARAMETER *param, char *file_name)
+{
+	char string[8192];
+	FILE *file;
+
+	if ((file = fopen(file_name, "wt")) == NULL)
+		return FALSE;
+	for (; param->name != NULL; param++)
+	{
+		sprint_param(string, sizeof(string), param);
+		fputs(string, file);
+	}
+	fclose(file);
+	return TRUE;
 }
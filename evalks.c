@@ -26,13 +26,12 @@
 /**
 evaluate_king_safety():
 Evaluates the overall safety of the given color's king.
-Created 110606; last modified 120508
+Created 110606; last modified 101926
 **/
 VALUE evaluate_king_safety(EVAL_BLOCK *eval_block, COLOR color)
 {
 	int r;
 	BITBOARD king_area;
-	BITBOARD pawn_attacks;
 	BITBOARD piece_attacks[2][5];
 	BOOL king_is_safe;
 	COLOR c;
@@ -57,10 +56,7 @@ VALUE evaluate_king_safety(EVAL_BLOCK *eval_block, COLOR color)
 	{
 		c = (r == 0) ? color : COLOR_FLIP(color);
 
-		pawn_attacks = SHIFT_FORWARD(board.piece_bb[PAWN] &
-				board.color_bb[c], c);
-		piece_attacks[r][PAWN] = SHIFT_LF(pawn_attacks) |
-		   	SHIFT_RT(pawn_attacks);
+		piece_attacks[r][PAWN] = board.pawn_entry.pawn_attacks[c];
 
 		for (piece = KNIGHT; piece <= QUEEN; piece++)
 			piece_attacks[r][piece] = attack_set[c][piece];
@@ -110,19 +106,17 @@ VALUE evaluate_king_safety(EVAL_BLOCK *eval_block, COLOR color)
 	DEBUG_EVAL(print("king safety: dynamic score[%C]=%V\n", color, eval));
 #endif
 
-	/* king shelter */
-	eval_temp = 0;
-	king_is_safe = FALSE;
+	/* king shelter: the pawn part is summed up by file in the pawn hash. */
 	file = FILE_OF(square);
-	for (shelter = KING_SIDE; shelter <= QUEEN_SIDE; shelter++)
+	eval_temp = board.pawn_entry.king_file_shelter[color][file];
+	king_is_safe = FALSE;
+	/* King is only "safe" on the first rank. */
+	if (RANK_OF(SQ_FLIP_COLOR(square, color)) == RANK_1)
 	{
-		if (file >= shelter_file[shelter][0] &&
-			file <= shelter_file[shelter][1])
+		for (shelter = KING_SIDE; shelter <= QUEEN_SIDE; shelter++)
 		{
-			eval_temp += board.pawn_entry.
-				king_shelter_value[color][shelter];
-			/* King is only "safe" on the first rank. */
-			if (RANK_OF(SQ_FLIP_COLOR(square, color)) == RANK_1)
+			if (file >= shelter_file[shelter][0] &&
+				file <= shelter_file[shelter][1])
 				king_is_safe = TRUE;
 		}
 	}
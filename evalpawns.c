@@ -23,10 +23,126 @@
 #include "eval.h"
 #include "bit.h"
 
+/**
+find_exact_attacks():
+Computes the set of squares attacked by each side, with no x-rays, using
+the fill routines. This is done for both sides at once so that the passed
+pawn paths can be evaluated with bitboard operations instead of calling
+is_attacked() on every square.
+Created 101926; last modified 101926
+**/
+void find_exact_attacks(void)
+{
+	COLOR color;
+	BITBOARD attacks;
+
+	for (color = WHITE; color <= BLACK; color++)
+	{
+		attacks = board.pawn_entry.pawn_attacks[color];
+		attacks |= fill_attacks_knight(board.piece_bb[KNIGHT] &
+			board.color_bb[color]);
+		attacks |= fill_attacks_bishop((board.piece_bb[BISHOP] |
+			board.piece_bb[QUEEN]) & board.color_bb[color], board.occupied_bb);
+		attacks |= fill_attacks_rook((board.piece_bb[ROOK] |
+			board.piece_bb[QUEEN]) & board.color_bb[color], board.occupied_bb);
+		attacks |= king_moves_bb[board.king_square[color]];
+		exact_attacks[color] = attacks;
+	}
+}
+
+/**
+passed_pawn_path():
+Evaluates the path of a passed pawn to the promotion square, and returns the
+multiplier for its value. The pawn can advance until it hits an occupied
+square, a square controlled by the opponent, or the last rank, so we find
+the first such square and count the squares in front of it all at once.
+Created 101926; last modified 101926
+**/
+int passed_pawn_path(SQUARE square, COLOR color)
+{
+	int multiplier;
+	BITBOARD path;
+	BITBOARD stop;
+	BITBOARD before;
+	BITBOARD controlled;
+	SQUARE front_square;
+
+	path = smear_forward[color](MASK(square)) ^ MASK(square);
+	controlled = exact_attacks[COLOR_FLIP(color)] & ~exact_attacks[color];
+	stop = path & (board.occupied_bb | controlled |
+		MASK_RANK_COLOR(RANK_8, color));
+	if (color == WHITE)
+		front_square = first_square(stop);
+	else
+		front_square = last_square(stop);
+	before = path & ~smear_forward[color](MASK(front_square));
+
+	good_squares[COLOR_FLIP(color)] |= before | MASK(front_square);
+
+	multiplier = 8 + 2 * pop_count(before) +
+		pop_count(before & exact_attacks[color]);
+	if (board.color[front_square] != EMPTY)
+		multiplier -= 3;
+	else if (controlled & MASK(front_square))
+		multiplier -= 6;
+	else
+	{
+		multiplier = 24;
+		if (exact_attacks[color] & MASK(front_square))
+			multiplier += 4;
+	}
+	return multiplier;
+}
+
+/**
+passed_pawn_path_scalar():
+The square-by-square version of passed_pawn_path(). This is only used by
+test_epd_eval() to verify the bitboard version.
+Created 110506; last modified 101926
+**/
+int passed_pawn_path_scalar(SQUARE square, COLOR color)
+{
+	int multiplier;
+	SQUARE front_square;
+
+	multiplier = 8;
+	front_square = square;
+	while (TRUE)
+	{
+		front_square += pawn_step[color];
+
+		good_squares[COLOR_FLIP(color)] |= MASK(front_square);
+
+		if (board.color[front_square] != EMPTY)
+		{
+			multiplier -= 3;
+			break;
+		}
+		if (is_attacked(front_square, COLOR_FLIP(color)) &&
+			!is_attacked(front_square, color))
+		{
+			multiplier -= 6;
+			break;
+		}
+		else if (RANK_OF(SQ_FLIP_COLOR(front_square, color)) == RANK_8)
+		{
+			multiplier = 24;
+			if (is_attacked(front_square, color))
+				multiplier += 4;
+			break;
+		}
+		if (is_attacked(front_square, color))
+			multiplier++;
+		multiplier += 2;
+	}
+	return multiplier;
+}
+
 /**
 evaluate_passed_pawns():
-Evaluate any passed pawns that might be on the board.
-Created 110506; last modified 060308
+Evaluate any passed pawns that might be on the board. find_exact_attacks()
+must have been called for this position.
+Created 110506; last modified 101926
 **/
 VALUE evaluate_passed_pawns(EVAL_BLOCK *eval_block, COLOR color)
 {
@@ -36,7 +152,6 @@ VALUE evaluate_passed_pawns(EVAL_BLOCK *eval_block, COLOR color)
 	BITBOARD friendly;
 	BITBOARD rook_defend;
 	BITBOARD rook_attack;
-	BITBOARD attackers[6];
 	SQUARE square;
 	SQUARE front_square;
 	VALUE eval_temp;
@@ -57,38 +172,7 @@ VALUE evaluate_passed_pawns(EVAL_BLOCK *eval_block, COLOR color)
 		CLEAR_BIT(pawns, square);
 
 		distance = 7 - RANK_OF(SQ_FLIP_COLOR(square, color));
-		multiplier = 8;
-		front_square = square;
-//		attackers[KNIGHT] = fill_attacks_knight(board.piece_bb[KNIGHT] & board.color_bb[COLOR_FLIP(color)]);
-//		attackers[BISHOP] = fill_attacks_bishop(board.piece_bb[BISHOP] & board.color_bb[COLOR_FLIP(color)], board.occupied_bb);
-		while (TRUE)
-		{
-			front_square += pawn_step[color];
-
-			good_squares[COLOR_FLIP(color)] |= MASK(front_square);
-
-			if (board.color[front_square] != EMPTY)
-			{
-				multiplier -= 3;
-				break;
-			}
-			if (is_attacked(front_square, COLOR_FLIP(color)) &&
-				!is_attacked(front_square, color))
-			{
-				multiplier -= 6;
-				break;
-			}
-			else if (RANK_OF(SQ_FLIP_COLOR(front_square, color)) == RANK_8)
-			{
-				multiplier = 24;
-				if (is_attacked(front_square, color))
-					multiplier += 4;
-				break;
-			}
-			if (is_attacked(front_square, color))
-				multiplier++;
-			multiplier += 2;
-		}
+		multiplier = passed_pawn_path(square, color);
 		if (rook_defend & MASK(square))
 			multiplier += 6;
 		if (rook_attack & MASK(square))
@@ -128,7 +212,7 @@ VALUE evaluate_passed_pawns(EVAL_BLOCK *eval_block, COLOR color)
 /**
 evaluate_pawns():
 Evaluates the pawn structure.
-Created 090106; last modified 082607
+Created 090106; last modified 101926
 **/
 VALUE evaluate_pawns(void)
 {
@@ -152,11 +236,14 @@ VALUE evaluate_pawns(void)
 	SQ_FILE file;
 	VALUE eval_temp;
 
-	ph_entry = &pawn_hash_table[board.pawn_entry.hashkey %
-		zct->pawn_hash_size];
-
-	zct->pawn_hash_probes++;
-	if (ph_entry->hashkey != 0 &&
+	ph_entry = NULL;
+	if (!eval_batch_mode)
+	{
+		ph_entry = &pawn_hash_table[board.pawn_entry.hashkey %
+			zct->pawn_hash_size];
+		zct->pawn_hash_probes++;
+	}
+	if (ph_entry != NULL && ph_entry->hashkey != 0 &&
 		ph_entry->hashkey == board.pawn_entry.hashkey)
 	{
 		zct->pawn_hash_hits++;
@@ -179,6 +266,9 @@ VALUE evaluate_pawns(void)
 	{
 		board.pawn_entry.open_files[color] =
 			(unsigned char)smear_down(pawns[color]);
+		/* Pawn attacks, used by the king safety and passed pawn eval. */
+		temp = SHIFT_FORWARD(pawns[color], color);
+		board.pawn_entry.pawn_attacks[color] = SHIFT_LF(temp) | SHIFT_RT(temp);
 		/* Evaluate king-pawn shelters on king and queen side. */
 		for (shelter = KING_SIDE; shelter <= QUEEN_SIDE; shelter++)
 		{
@@ -204,6 +294,20 @@ VALUE evaluate_pawns(void)
 			board.pawn_entry.king_shelter_value[color][shelter] =
 				king_shelter_value[eval_temp];
 		}
+		/* Sum up the shelters for each file the king can be on, so that
+			the king safety eval just needs a lookup. */
+		for (file = FILE_A; file <= FILE_H; file++)
+		{
+			eval_temp = 0;
+			for (shelter = KING_SIDE; shelter <= QUEEN_SIDE; shelter++)
+			{
+				if (file >= shelter_file[shelter][0] &&
+					file <= shelter_file[shelter][1])
+					eval_temp += board.pawn_entry.
+						king_shelter_value[color][shelter];
+			}
+			board.pawn_entry.king_file_shelter[color][file] = eval_temp;
+		}
 		/* Count the number of pawns on each square color for bishop eval. */
 		for (sq_color = WHITE; sq_color <= BLACK; sq_color++)
 		{
@@ -319,7 +423,8 @@ VALUE evaluate_pawns(void)
 		board.pawn_entry.eval[color] += eval_temp;
 	}
 #endif
-	*ph_entry = board.pawn_entry;
+	if (ph_entry != NULL)
+		*ph_entry = board.pawn_entry;
 	return board.pawn_entry.eval[board.side_tm] -
 		board.pawn_entry.eval[board.side_ntm];
 }
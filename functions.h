@@ -41,6 +41,32 @@ BITBOARD flood_fill_king(BITBOARD attackers, BITBOARD occupied, int moves);
 int first_bit_8(unsigned char b);
 void initialize_attacks(void);
 BITBOARD dir_attacks(SQUARE from, BITBOARD occupied, DIRECTION dir);
+/* bitbase.c */
+void initialize_bitbases(void);
+void bitbase_file_name(BITBASE *bb, char *file_name);
+BOOL bitbase_load(BITBASE *bb, char *file_name);
+BOOL bitbase_save(BITBASE *bb, char *file_name);
+SQUARE bitbase_transform(SQUARE square, int t);
+BITBOARD bitbase_index(BITBASE *bb, SQUARE *square, COLOR side_tm);
+COLOR bitbase_squares(BITBASE *bb, BITBOARD index, SQUARE *square);
+BITBASE *bitbase_match(int count, PIECE *piece, COLOR *color, SQUARE *square,
+	SQUARE *bb_square, COLOR *strong);
+COLOR bitbase_lookup(int count, PIECE *piece, COLOR *color, SQUARE *square,
+	COLOR side_tm);
+BOOL bitbase_probe(VALUE *value);
+BITBOARD bitbase_attacks(PIECE piece, COLOR color, SQUARE square,
+	BITBOARD occupied);
+BOOL bitbase_attacked(int count, PIECE *piece, COLOR *color, SQUARE *square,
+	BITBOARD occupied, SQUARE target, COLOR attacker);
+int bitbase_child(BITBASE *bb, SQUARE *square, int index, SQUARE to,
+	PIECE promote);
+BOOL bitbase_generate_position(BITBASE *bb, BITBOARD index);
+BOOL bitbase_generate_range(BITBASE *bb, BITBOARD start, BITBOARD end);
+void bitbase_generate(BITBASE *bb);
+#ifdef SMP
+void bitbase_generate_work(void);
+#endif
+
 /* book.c */
 void book_update(char *pgn_file_name, char *book_file_name, int width,
 	int depth, int win_percent);
@@ -50,16 +76,19 @@ BOOL book_probe(void);
 BOOL in_check(void);
 BITBOARD check_squares(void);
 BOOL is_attacked(SQUARE square, COLOR color);
+BOOL is_attacked_cached(EVAL_BLOCK *eval_block, SQUARE square, COLOR color);
 BITBOARD attack_squares(SQUARE square, COLOR color);
-BOOL move_gives_check(MOVE move);
+void get_check_info(CHECK_INFO *ci);
+BOOL move_gives_check(MOVE move, CHECK_INFO *ci);
 BOOL is_pinned(SQUARE to, COLOR color);
 void get_attack_bb_set(BITBOARD *checks, BITBOARD not_pinned[],
 	BITBOARD *all_pinned);
 BOOL is_mate(void);
 void check_legality(MOVE *first, MOVE **last);
 BOOL is_repetition(int limit);
-BOOL is_quiet(void);
+VALUE qsearch_value(void);
 void generate_root_moves(void);
+void restrict_root_moves(void);
 BOOL check_result(BOOL print_result);
 /* cmd.c */
 int command(char *input);
@@ -69,20 +98,29 @@ void display_help(void);
 STR_HASHKEY str_hashkey(char *input, int size);
 /* eval.c */
 VALUE evaluate(EVAL_BLOCK *eval_block);
+VALUE evaluate_lazy(EVAL_BLOCK *eval_block, VALUE alpha, VALUE beta);
 VALUE material_balance(void);
 BOOL can_mate(COLOR color);
+/* evalbatch.c */
+VALUE batch_value(BATCH_TYPE type);
+void evaluate_batch(PACKED_POS *pos, VALUE *score, int count, BATCH_TYPE type);
+#ifdef SMP
+void evaluate_batch_work(void);
+#endif
 /* gen.c */
 MOVE *generate_moves(MOVE *next_move);
 MOVE *generate_captures(MOVE *next_move);
-MOVE *generate_checks(MOVE *next_move);
+MOVE *generate_checks(MOVE *next_move, EVAL_BLOCK *eval_block);
 MOVE *generate_evasions(MOVE *next_move, BITBOARD checkers);
 MOVE *generate_legal_moves(MOVE *next_move);
+MOVE *generate_legal(MOVE *next_move, GEN_TYPE type);
 /* hash.c */
 BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch);
 void hash_store(SEARCH_BLOCK *sb, MOVE move, VALUE value, HASH_BOUND_TYPE type, BOOL is_qsearch);
 void stuff_pv(int depth, MOVE *pv, VALUE value);
 int age_difference(int age);
 void hash_clear(void);
+void hash_clear_local(void);
 void hash_print(void);
 /* init.c */
 void initialize_settings(void);
@@ -92,6 +130,8 @@ void initialize_board(char *position);
 void initialize_bitboards(void);
 void initialize_hashkey(void);
 void hash_alloc(BITBOARD hash_table_size);
+BOOL pack_position(PACKED_POS *pos);
+void unpack_position(PACKED_POS *pos);
 /* initeval.c */
 void initialize_eval(void);
 /* input.c */
@@ -101,6 +141,7 @@ int input_move(char *string, INPUT_MODE mode);
 BOOL input_available(void);
 /* make.c */
 BOOL make_move(MOVE move);
+void make_legal_move(MOVE move);
 void update_path_hashkey(MOVE move);
 BOOL is_legal(MOVE move);
 /* output.c */
@@ -118,6 +159,7 @@ char *value_prob_string(VALUE value);
 char *search_block_string(SEARCH_BLOCK *sb);
 char *search_state_string(SEARCH_STATE ss);
 void display_search_line(BOOL final, MOVE *pv, VALUE value);
+void display_multi_pv(BOOL final, ROOT_MOVE **line, int line_count);
 void display_search_header(void);
 void line_wrap(char *string, int size, int column);
 /* perft.c */
@@ -136,6 +178,8 @@ void sprint_(char *string, int max_length, char *text, va_list args);
 /* rand.c */
 HASHKEY random_hashkey(void);
 void seed_random(HASHKEY hashkey);
+/* regress.c */
+void regress(void);
 /* search.c */
 VALUE search(SEARCH_BLOCK *search_block);
 /* searchroot.c */
@@ -143,6 +187,11 @@ void search_root(void);
 void clear_search(void);
 void initialize_search(void);
 void print_search_info(void);
+void print_research_counts(void);
+void print_tree_stats(void);
+void add_counters(SEARCH_COUNTERS *to, SEARCH_COUNTERS *from);
+void subtract_counters(SEARCH_COUNTERS *to, SEARCH_COUNTERS *from);
+void clear_counters(SEARCH_COUNTERS *counters);
 void sum_counters(void);
 void initialize_counters(void);
 /* search2.c */
@@ -166,8 +215,18 @@ BOOL search_check(void);
 BOOL stop_search(void);
 /* see.c */
 VALUE see(SQUARE to, SQUARE from);
+VALUE see_cached(EVAL_BLOCK *eval_block, SQUARE to, SQUARE from);
+BOOL see_ge(SQUARE to, SQUARE from, VALUE threshold);
+BOOL see_ge_cached(EVAL_BLOCK *eval_block, SQUARE to, SQUARE from,
+	VALUE threshold);
 /* select.c */
 void score_moves(SEARCH_BLOCK *sb);
+void score_captures(SEARCH_BLOCK *sb);
+void score_quiets(SEARCH_BLOCK *sb);
+BOOL move_is_tried(SEARCH_BLOCK *sb, MOVE move);
+BOOL killer_is_valid(SEARCH_BLOCK *sb, MOVE move);
+MOVE select_best(MOVE *first_move, MOVE *next_move, MOVE *last_move);
+void sort_moves(MOVE *first_move, MOVE *last_move);
 void score_caps(SEARCH_BLOCK *sb);
 void score_checks(SEARCH_BLOCK *sb);
 MOVE select_move(SEARCH_BLOCK *sb);
@@ -197,13 +256,16 @@ void stop_clocks(void);
 void set_zct_clock(int time);
 void set_opponent_clock(int time);
 /* tune.c */
-void tune_pgn(char *file_name);
+void extract_positions(char *pgn_name, char *out_name, BOOL fen, int min_ply,
+	VALUE margin, VALUE max_balance, BOOL decisive);
+void tune_eval(char *file_name, int iterations, char *ini_name);
 float value_to_prob(VALUE value);
 /* unmake.c */
 void unmake_move(void);
 /* verify.c */
 void verify(void);
 BOOL move_is_valid(MOVE move);
+BOOL move_is_legal(SEARCH_BLOCK *sb, MOVE move);
 /* zct.c */
 void game_loop(void);
 char *zct_version_string(void);
@@ -202,10 +202,11 @@ MOVE *generate_captures(MOVE *next_move)
 generate_checks():
 Generates pseudo-legal checking moves. Note that this does not generate any
 captures, as it is intended to be used in quiescence after the captures have
-already been generated and tried.
-Created 103006; last modified 052107
+already been generated and tried. If the eval block has attack maps for this
+position, they are used to skip piece types that can't reach a checking square.
+Created 103006; last modified 101926
 **/
-MOVE *generate_checks(MOVE *next_move)
+MOVE *generate_checks(MOVE *next_move, EVAL_BLOCK *eval_block)
 {
 	BITBOARD forward_pawns;
 	BITBOARD moves;
@@ -247,6 +248,12 @@ MOVE *generate_checks(MOVE *next_move)
 	for (piece = KNIGHT; piece <= QUEEN; piece++)
 	{
 		target = ~board.occupied_bb & attacks_bb(piece, king_square);
+		if (eval_block != NULL && eval_block->attacks[board.side_tm] != 0)
+		{
+			target &= eval_block->attacks[board.side_tm];
+			if (!target)
+				continue;
+		}
 		pieces = board.color_bb[board.side_tm] & board.piece_bb[piece];
 		while (pieces)
 		{
@@ -268,9 +275,9 @@ MOVE *generate_checks(MOVE *next_move)
 	/* King side */
 	if (CAN_CASTLE_KS(board.castle_rights, board.side_tm) &&
 		!(board.occupied_bb & castle_ks_mask[board.side_tm]) &&
-		!is_attacked(from, board.side_ntm) &&
-		!is_attacked(from + 1, board.side_ntm) &&
-		!is_attacked(from + 2, board.side_ntm))
+		!is_attacked_cached(eval_block, from, board.side_ntm) &&
+		!is_attacked_cached(eval_block, from + 1, board.side_ntm) &&
+		!is_attacked_cached(eval_block, from + 2, board.side_ntm))
 	{
 		/* Get the theoretical occupied state after the castling. */
 		pieces = board.occupied_bb ^
@@ -282,9 +289,9 @@ MOVE *generate_checks(MOVE *next_move)
 	/* Queen Side */
 	if (CAN_CASTLE_QS(board.castle_rights, board.side_tm) &&
 		!(board.occupied_bb & castle_qs_mask[board.side_tm]) &&
-		!is_attacked(from, board.side_ntm) &&
-		!is_attacked(from - 1, board.side_ntm) &&
-		!is_attacked(from - 2, board.side_ntm))
+		!is_attacked_cached(eval_block, from, board.side_ntm) &&
+		!is_attacked_cached(eval_block, from - 1, board.side_ntm) &&
+		!is_attacked_cached(eval_block, from - 2, board.side_ntm))
 	{
 		/* Get the theoretical occupied state after the castling. */
 		pieces = board.occupied_bb ^
@@ -420,9 +427,21 @@ MOVE *generate_evasions(MOVE *next_move, BITBOARD checkers)
 /**
 generate_legal_moves():
 Generates legal moves.
-Created 090308; last modified 112308
+Created 090308; last modified 101926
 **/
 MOVE *generate_legal_moves(MOVE *next_move)
+{
+	return generate_legal(next_move, GEN_ALL);
+}
+
+/**
+generate_legal():
+Generates legal moves of the given type: all moves, captures and promotions
+only, or the remaining quiet moves. The captures and the quiets together give
+exactly the same moves as GEN_ALL.
+Created 101926; last modified 101926
+**/
+MOVE *generate_legal(MOVE *next_move, GEN_TYPE type)
 {
 	BITBOARD not_pinned[4];
 	BITBOARD all_pinned;
@@ -435,6 +454,8 @@ MOVE *generate_legal_moves(MOVE *next_move)
 	BITBOARD moves;
 	BITBOARD target;
 	BITBOARD evasion_target;
+	BITBOARD type_target;
+	BITBOARD push_target;
 	PIECE piece;
 	SQUARE from;
 	SQUARE to;
@@ -460,11 +481,31 @@ MOVE *generate_legal_moves(MOVE *next_move)
 	else
 		evasion_target = 0;
 
+	/* Calculate the targets for the type of moves we want. Pawn pushes are
+		split up separately, as promotions are generated with the captures. */
+	if (type == GEN_CAPTURES)
+	{
+		type_target = board.color_bb[board.side_ntm];
+		push_target = MASK_RANK_COLOR(RANK_8, board.side_tm);
+	}
+	else if (type == GEN_QUIETS)
+	{
+		type_target = ~board.occupied_bb;
+		push_target = ~MASK_RANK_COLOR(RANK_8, board.side_tm);
+	}
+	else
+	{
+		type_target = ~(BITBOARD)0;
+		push_target = ~(BITBOARD)0;
+	}
+
 	if (check_count < 2)
 	{
 	/* pawns */
 	pieces = board.piece_bb[PAWN] & board.color_bb[board.side_tm];
 	target = board.color_bb[board.side_ntm] & evasion_target;
+	if (type == GEN_QUIETS)
+		target = 0;
 	/* pawn caps left */
 	dir = pawn_dir[board.side_tm];
 	valid = pieces & not_pinned[dir];
@@ -484,7 +525,7 @@ MOVE *generate_legal_moves(MOVE *next_move)
 		PAWN_PUSH(next_move, from, to);
 	}
 	/* en passant caps */
-	if (board.ep_square != OFF_BOARD)
+	if (board.ep_square != OFF_BOARD && type != GEN_QUIETS)
 	{
 		to = board.ep_square;
 		valid = pawn_caps_bb[board.side_ntm][to] &
@@ -514,13 +555,15 @@ MOVE *generate_legal_moves(MOVE *next_move)
 	moves = SHIFT_FORWARD(valid, board.side_tm) & target;
 	/* save pawns on 3rd rank to double push afterwards */
 	pieces = moves & MASK_RANK_COLOR(RANK_3, board.side_tm);
-	moves &= evasion_target;
+	moves &= evasion_target & push_target;
 	FOR_BB(to, moves)
 	{
 		from = to - pawn_step[board.side_tm];
 		PAWN_PUSH(next_move, from, to);
 	}
 	/* pawn double steps */
+	if (type == GEN_CAPTURES)
+		pieces = 0;
 	moves = SHIFT_FORWARD(pieces, board.side_tm) & target & evasion_target;
 	FOR_BB(to, moves)
 	{
@@ -528,7 +571,7 @@ MOVE *generate_legal_moves(MOVE *next_move)
 		*next_move++ = SET_FROM(from) | SET_TO(to);
 	}
 
-	target = ~board.color_bb[board.side_tm] & evasion_target;
+	target = ~board.color_bb[board.side_tm] & evasion_target & type_target;
 	/* Calculate moves for knights. */
 	pieces = board.piece_bb[KNIGHT] & board.color_bb[board.side_tm];
 	valid = pieces & ~all_pinned;
@@ -581,7 +624,7 @@ MOVE *generate_legal_moves(MOVE *next_move)
 	}
 
 	/* king */
-	target = ~board.color_bb[board.side_tm];
+	target = ~board.color_bb[board.side_tm] & type_target;
 	from = board.king_square[board.side_tm];
 	moves = king_moves_bb[from] & target;
 	old_occupied_bb = board.occupied_bb;
@@ -594,6 +637,8 @@ MOVE *generate_legal_moves(MOVE *next_move)
 	board.occupied_bb = old_occupied_bb;
 
 	/* castling */
+	if (type == GEN_CAPTURES)
+		return next_move;
 	if (CAN_CASTLE_KS(board.castle_rights, board.side_tm) &&
 		!(board.occupied_bb & castle_ks_mask[board.side_tm]) &&
 		!checks &&
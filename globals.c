@@ -26,7 +26,11 @@ THREAD_LOCAL BOARD board;
 GLOBALS *zct;
 #else
 GLOBALS zct[1];
+HEURISTIC_TABLE heuristic_table;
 #endif
+/* move ordering tables, shared by all processors unless
+	zct->shared_heuristics is off */
+HEURISTIC_TABLE *heuristics;
 
 /* various constant board data */
 const int pawn_step[2] = { 8, -8 };
@@ -28,7 +28,9 @@ extern THREAD_LOCAL BOARD board;
 extern GLOBALS *zct;
 #else
 extern GLOBALS zct[1];
+extern HEURISTIC_TABLE heuristic_table;
 #endif
+extern HEURISTIC_TABLE *heuristics;
 
 /* various constant board data */
 extern const int pawn_step[2];
@@ -57,6 +59,10 @@ extern THREAD_LOCAL HASH_ENTRY *qsearch_hash_table;
 extern THREAD_LOCAL PAWN_HASH_ENTRY *pawn_hash_table;
 extern THREAD_LOCAL EVAL_HASH_ENTRY *eval_hash_table;
 
+/* bitbases */
+extern const char bitbase_name[BITBASE_COUNT][8];
+extern BITBASE *bitbase;
+
 extern unsigned int sb_id;
 extern THREAD_LOCAL GAME_ENTRY *root_entry;
 
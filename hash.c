@@ -20,6 +20,9 @@
 #include "zct.h"
 #include "functions.h"
 #include "globals.h"
+#include "smp.h"
+#include "profile.h"
+#include "trace.h"
 
 //#define USE_SPDH
 //#define PV_HASH_CUTOFFS
@@ -28,7 +31,7 @@
 hash_probe():
 Probes the hash table for the current position. Returns a move and score,
 if they are found.
-Created 081706; last modified 051208
+Created 081706; last modified 101926
 **/
 BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch)
 {
@@ -38,7 +41,10 @@ BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch)
 	VALUE value;
 	HASHKEY hashkey;
 	BITBOARD data;
+	unsigned short check;
+	PROFILE_DECLARE(profile_start)
 
+	PROFILE_START(profile_start);
 	hashkey = HASH_NON_PATH(board.hashkey);
 	if (is_qsearch)
 	{
@@ -48,22 +54,22 @@ BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch)
 	else
 	{
 		entry = &zct->hash_table[hashkey % zct->hash_size];
-		zct->hash_probes++;
+		COUNTER_INC(hash_probes);
 	}
 	for (x = 0; x < HASH_SLOT_COUNT; x++)
 	{
-		hashkey = entry->entry[x].hashkey;
+		check = entry->entry[x].check;
 		data = entry->entry[x].data;
 #ifdef USE_SPDH
-		if (HASH_NON_PATH(hashkey ^ data) == HASH_NON_PATH(board.hashkey))
+		if (HASH_CHECK_MATCH(check, data, board.hashkey))
 #else
-		if ((hashkey ^ data) == board.hashkey)
+		if (HASH_SLOT_MATCH(check, data, board.hashkey))
 #endif
 		{
 			if (is_qsearch)
 				zct->qsearch_hash_hits++;
 			else
-				zct->hash_hits++;
+				COUNTER_INC(hash_hits);
 			sb->hash_move = HASH_MOVE(data);
 #ifndef PV_HASH_CUTOFFS
 			if (sb->node_type != NODE_PV)
@@ -71,16 +77,16 @@ BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch)
 #ifdef USE_SPDH
 			/* Only allow cutoffs in the case of the paths being the same. */
 			if (HASH_DEPTH(data) >= sb->depth &&
-					HASH_PATH(hashkey ^ data) == HASH_PATH(board.path_hashkey))
+					HASH_KEY_MATCH(data, board.path_hashkey))
 #else
 			if (HASH_DEPTH(data) >= sb->depth)
 #endif
 			{
 				value = HASH_VALUE(data);
 				/* Adjust the score for mates and bitbase hits. */
-				if (value >= MATE - MAX_PLY)
+				if (value >= BITBASE_WIN - MAX_PLY)
 					value -= sb->ply;
-				else if (value <= -MATE + MAX_PLY)
+				else if (value <= -BITBASE_WIN + MAX_PLY)
 					value += sb->ply;
 
 				/* Check for cutoffs. */
@@ -88,9 +94,11 @@ BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch)
 				if (type == HASH_EXACT_BOUND)
 				{
 					if (!is_qsearch)
-						zct->hash_cutoffs++;
+						COUNTER_INC(hash_cutoffs);
 					sb->alpha = value;
-					return TRUE;
+					if (zct->trace)
+						trace_hash(sb, TRUE);
+					PROFILE_RETURN(PROFILE_HASH_PROBE, profile_start, TRUE);
 				}
 				if (value < sb->beta && type == HASH_UPPER_BOUND)
 					sb->beta = value + 1;
@@ -99,20 +107,24 @@ BOOL hash_probe(SEARCH_BLOCK *sb, BOOL is_qsearch)
 				if (sb->alpha >= sb->beta)
 				{
 					if (!is_qsearch)
-						zct->hash_cutoffs++;
-					return TRUE;
+						COUNTER_INC(hash_cutoffs);
+					if (zct->trace)
+						trace_hash(sb, TRUE);
+					PROFILE_RETURN(PROFILE_HASH_PROBE, profile_start, TRUE);
 				}
 			}
+			if (zct->trace)
+				trace_hash(sb, FALSE);
 			break;
 		}
 	}
-	return FALSE;
+	PROFILE_RETURN(PROFILE_HASH_PROBE, profile_start, FALSE);
 }
 
 /**
 hash_store():
 Stores the given information about the position in the hash table.
-Created 081706; last modified 060808
+Created 081706; last modified 101926
 **/
 void hash_store(SEARCH_BLOCK *sb, MOVE move, VALUE value,
 		HASH_BOUND_TYPE type, BOOL is_qsearch)
@@ -124,10 +136,11 @@ void hash_store(SEARCH_BLOCK *sb, MOVE move, VALUE value,
 	BITBOARD data;
 	BITBOARD hashkey;
 	HASH_ENTRY *entry;
+	unsigned short check;
 
-	if (value >= MATE - MAX_PLY)
+	if (value >= BITBASE_WIN - MAX_PLY)
 		value += sb->ply;
-	else if (value <= -MATE + MAX_PLY)
+	else if (value <= -BITBASE_WIN + MAX_PLY)
 		value -= sb->ply;
 
 	hashkey = HASH_NON_PATH(board.hashkey);
@@ -135,18 +148,25 @@ void hash_store(SEARCH_BLOCK *sb, MOVE move, VALUE value,
 		entry = &qsearch_hash_table[hashkey % zct->qsearch_hash_size];
 	else
 		entry = &zct->hash_table[hashkey % zct->hash_size];
-	/* Now look through the slots to find the best slot to store in. */
+	/* Now look through the slots to find the best slot to store in. The
+		replacement value of each slot is its depth, with older entries
+		(relative to the current search age) devalued by two plies per search.
+		Empty slots are always taken first. */
 	best_slot = 0;
 	best_depth = MAX_PLY * PLY + 1024;
 	for (x = 0; x < HASH_SLOT_COUNT; x++)
 	{
-		hashkey = entry->entry[x].hashkey;
+		check = entry->entry[x].check;
 		data = entry->entry[x].data;
-		rel_depth = HASH_DEPTH(data) - age_difference(HASH_AGE(data)) * 2 * PLY;
+		if (data == 0)
+			rel_depth = -MAX_SEARCH_AGE * 2 * PLY;
+		else
+			rel_depth = HASH_DEPTH(data) -
+				age_difference(HASH_AGE(data)) * 2 * PLY;
 #ifdef USE_SPDH
-		if (HASH_NON_PATH(hashkey ^ data) == HASH_NON_PATH(board.hashkey))
+		if (HASH_CHECK_MATCH(check, data, board.hashkey))
 #else
-		if ((hashkey ^ data) == board.hashkey)
+		if (HASH_SLOT_MATCH(check, data, board.hashkey))
 #endif
 		{
 			if (HASH_DEPTH(data) > sb->depth)
@@ -170,23 +190,24 @@ void hash_store(SEARCH_BLOCK *sb, MOVE move, VALUE value,
 		age_difference(HASH_AGE(entry->entry[best_slot].data)) > 1)
 	{
 		/* Update the hash fill statistic. */
-		if (!is_qsearch && entry->entry[best_slot].data == 0 &&
-			   	entry->entry[best_slot].hashkey == 0)
+		if (!is_qsearch && entry->entry[best_slot].data == 0)
 			zct->hash_entries_full++;
 		/* Store the data in the hash table. */
 	//	if (move == NO_MOVE)
 	//		move = HASH_MOVE(entry->entry[best_slot].data);
-		data = SET_HASH_DEPTH(sb->depth) | SET_HASH_AGE(zct->search_age) |
-		   	SET_HASH_TYPE(type) | SET_HASH_THREAT(sb->threat) |
-		   	SET_HASH_VALUE(value) | SET_HASH_MOVE(move);
 #ifdef USE_SPDH
-		hashkey = (HASH_NON_PATH(board.hashkey) |
-			   	HASH_PATH(board.path_hashkey)) ^ data;
+		hashkey = HASH_NON_PATH(board.hashkey) |
+			HASH_PATH(board.path_hashkey);
 #else
-		hashkey = board.hashkey ^ data;
+		hashkey = board.hashkey;
 #endif
+		data = SET_HASH_DEPTH(sb->depth) | SET_HASH_AGE(zct->search_age) |
+		   	SET_HASH_TYPE(type) | SET_HASH_THREAT(sb->threat) |
+		   	SET_HASH_VALUE(value) | SET_HASH_MOVE(move) |
+			SET_HASH_KEY(hashkey);
+		check = HASH_CHECK(hashkey, data);
 		entry->entry[best_slot].data = data;
-		entry->entry[best_slot].hashkey = hashkey;
+		entry->entry[best_slot].check = check;
 	}
 }
 
@@ -204,60 +225,86 @@ int age_difference(int age)
 
 /**
 hash_clear():
-Clears the hash table of all entries, as well as move ordering data.
-Created 053107; last modified 011808
+Clears the hash table of all entries, as well as move ordering data. The child
+processors are told to clear their own tables as well.
+Created 053107; last modified 101926
 **/
 void hash_clear(void)
 {
 	BITBOARD entry;
 	int x;
-	int y;
-	BITBOARD hashkey;
-	BITBOARD data;
-	COLOR c;
+#ifdef SMP
+	int p;
+#endif
 
+	/* An all-zero slot is empty: it has no bound type, and hash_store()
+		recognizes it as free. */
 	zct->hash_entries_full = 0;
-	hashkey = (HASHKEY)0;
-	data = SET_HASH_DEPTH(0) | SET_HASH_AGE(0) | SET_HASH_TYPE(HASH_NO_BOUND) |
-		SET_HASH_THREAT(0) | SET_HASH_VALUE(0) | SET_HASH_MOVE(NO_MOVE);
 	/* main hash table */
 	for (entry = 0; entry < zct->hash_size; entry++)
 	{
 		for (x = 0; x < HASH_SLOT_COUNT; x++)
 		{
-			zct->hash_table[entry].entry[x].hashkey = hashkey;
-			zct->hash_table[entry].entry[x].data = data;
+			zct->hash_table[entry].entry[x].check = 0;
+			zct->hash_table[entry].entry[x].data = 0;
 		}
 	}
+	hash_clear_local();
+#ifdef SMP
+	/* The qsearch hash table is private to each processor, and so are the
+		move ordering tables when they aren't shared. The child processors
+		are always idle here, so we can activate them just long enough to
+		send the message, like cmd_hash() does. */
+	for (p = 1; p < zct->process_count; p++)
+	{
+		make_active(p);
+		smp_tell(p, SMP_CLEAR_HASH, 0);
+		make_idle(p);
+	}
+#endif
+}
+
+/**
+hash_clear_local():
+Clears the tables that this processor can see: the qsearch hash table and the
+move ordering tables.
+Created 101926; last modified 101926
+**/
+void hash_clear_local(void)
+{
+	BITBOARD entry;
+	int x;
+	int y;
+	COLOR c;
+
 	/* qsearch hash table */
 	for (entry = 0; entry < zct->qsearch_hash_size; entry++)
 	{
 		for (x = 0; x < HASH_SLOT_COUNT; x++)
 		{
-			qsearch_hash_table[entry].entry[x].hashkey = hashkey;
-			qsearch_hash_table[entry].entry[x].data = data;
+			qsearch_hash_table[entry].entry[x].check = 0;
+			qsearch_hash_table[entry].entry[x].data = 0;
 		}
 	}
 	/* history tables */
-	zct->history_counter = 1;
 	for (c = WHITE; c <= BLACK; c++)
 		for (x = 0; x < 4096; x++)
-			zct->history_table[c][x] = 0;
+			heuristics->history_table[c][x] = 0;
 	/* killer tables */
 	for (x = 0; x < MAX_PLY; x++)
 		for (y = 0; y < 2; y++)
-			zct->killer_move[x][y] = NO_MOVE;
+			heuristics->killer_move[x][y] = NO_MOVE;
 	/* counter-move tables */
 	for (c = WHITE; c <= BLACK; c++)
 		for (x = 0; x < 4096; x++)
 			for (y = 0; y < 2; y++)
-				zct->counter_move[c][x][y] = NO_MOVE;
+				heuristics->counter_move[c][x][y] = NO_MOVE;
 }
 
 /**
 hash_print():
 Probes the hash table for the current position, and displays any information found in it.
-Created 051507; last modified 051208
+Created 051507; last modified 101926
 **/
 void hash_print(void)
 {
@@ -269,18 +316,18 @@ void hash_print(void)
 	HASH_ENTRY *entry;
 	MOVE move;
 	VALUE value;
-	HASHKEY hashkey;
 	BITBOARD data;
+	unsigned short check;
 
-	entry = &zct->hash_table[board.hashkey % zct->hash_size];
+	entry = &zct->hash_table[HASH_NON_PATH(board.hashkey) % zct->hash_size];
 	for (x = 0; x < HASH_SLOT_COUNT; x++)
 	{
-		hashkey = entry->entry[x].hashkey;
+		check = entry->entry[x].check;
 		data = entry->entry[x].data;
 #ifdef USE_SPDH
-		if (HASH_NON_PATH(hashkey ^ data) == HASH_NON_PATH(board.hashkey))
+		if (HASH_CHECK_MATCH(check, data, board.hashkey))
 #else
-		if ((hashkey ^ data) == board.hashkey)
+		if (HASH_SLOT_MATCH(check, data, board.hashkey))
 #endif
 		{
 			depth = HASH_DEPTH(entry->entry[x].data);
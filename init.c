@@ -27,12 +27,17 @@
 /**
 initialize_settings():
 Sets up all of the standard engine state variables.
-Created 051708; last modified 051708
+Created 051708; last modified 101926
 **/
 void initialize_settings(void)
 {
 #if !defined(ZCT_WINDOWS) && defined(SMP)
 	zct = (GLOBALS *)shared_alloc(sizeof(GLOBALS));
+	heuristics = (HEURISTIC_TABLE *)shared_alloc(sizeof(HEURISTIC_TABLE));
+	feature_weight = shared_alloc(sizeof(feature_weight_table));
+#else
+	heuristics = &heuristic_table;
+	feature_weight = feature_weight_table;
 #endif
 
 	/* Initialize the standard global stuff. */
@@ -70,6 +75,15 @@ void initialize_settings(void)
 	set_time_control(0, 5 * 60000, 0);
 	zct->nodes_per_check = 10000;
 	zct->output_limit = 20000;
+	zct->aspiration_window = 30;
+	zct->root_split = FALSE;
+	zct->shared_heuristics = TRUE;
+	zct->multi_pv = 1;
+	zct->feature_eval = FALSE;
+	zct->trace = FALSE;
+	zct->tree_stats = FALSE;
+	zct->trace_generation = 0;
+	zct->search_move_count = 0;
 	zct->max_depth = 0;
 	zct->max_nodes = 0;
 	zct->check_extension = 3;
@@ -77,7 +91,6 @@ void initialize_settings(void)
 	zct->threat_extension = 4;
 	zct->passed_pawn_extension = 3;
 	zct->lmr_threshold = 70;
-	zct->history_counter = 1;
 	zct->hash_size = 32 * HASH_MB;
 	zct->qsearch_hash_size = 256 * HASH_KB;
 	zct->pawn_hash_size = 1 * PAWN_HASH_MB;
@@ -383,11 +396,82 @@ void initialize_board(char *fen)
 	reset_clocks();
 }
 
+/**
+pack_position():
+Packs the current board into a PACKED_POS. This fails (and returns FALSE) only
+when there are more than 32 pieces on the board.
+Created 101926; last modified 101926
+**/
+BOOL pack_position(PACKED_POS *pos)
+{
+	int x;
+	BITBOARD pieces;
+	SQUARE square;
+
+	if (pop_count(board.occupied_bb) > 32)
+		return FALSE;
+
+	memset(pos, 0, sizeof(PACKED_POS));
+	pos->occupied = board.occupied_bb;
+	x = 0;
+	pieces = board.occupied_bb;
+	FOR_BB(square, pieces)
+	{
+		pos->piece[x >> 1] |= (board.piece[square] | board.color[square] << 3)
+			<< ((x & 1) << 2);
+		x++;
+	}
+	pos->side_tm = board.side_tm;
+	pos->castle_rights = board.castle_rights;
+	pos->ep_square = board.ep_square;
+	pos->fifty_count = MIN(board.fifty_count, 255);
+	return TRUE;
+}
+
+/**
+unpack_position():
+Sets up the board from a PACKED_POS. Like initialize_board(), the game history
+is cleared, but none of the game state in zct is touched.
+Created 101926; last modified 101926
+**/
+void unpack_position(PACKED_POS *pos)
+{
+	int x;
+	int nibble;
+	BITBOARD pieces;
+	SQUARE square;
+
+	for (square = A1; square < OFF_BOARD; square++)
+	{
+		board.piece[square] = EMPTY;
+		board.color[square] = EMPTY;
+	}
+	x = 0;
+	pieces = pos->occupied;
+	FOR_BB(square, pieces)
+	{
+		nibble = pos->piece[x >> 1] >> ((x & 1) << 2);
+		board.piece[square] = (PIECE)(nibble & 7);
+		board.color[square] = (COLOR)(nibble >> 3 & 1);
+		x++;
+	}
+	board.side_tm = (COLOR)pos->side_tm;
+	board.side_ntm = COLOR_FLIP(board.side_tm);
+	board.castle_rights = pos->castle_rights;
+	board.ep_square = pos->ep_square;
+	board.fifty_count = pos->fifty_count;
+	board.move_number = 1;
+	board.game_entry = &board.game_stack[0];
+
+	initialize_bitboards();
+	initialize_hashkey();
+}
+
 /**
 initialize_bitboards():
 Set up piece and occupied bitboards from the piece[] and color[] arrays. Also
 sets up other board representation data.
-Created 070105; last modified 081608
+Created 070105; last modified 101926
 **/
 void initialize_bitboards(void)
 {
@@ -403,10 +487,15 @@ void initialize_bitboards(void)
 		board.pawn_count[color] = 0;
 		board.piece_count[color] = 0;
 		board.material[color] = 0;
+		board.psq_opening[color] = 0;
+		board.psq_endgame[color] = 0;
 	}
 
 	for (piece = 0; piece < 6; piece++)
+	{
 		board.piece_bb[piece] = (BITBOARD)0;
+		board.piece_type_count[piece] = 0;
+	}
 
 	/* Loop through all squares and add in the piece data. */
 	for (square = A1; square < OFF_BOARD; square++)
@@ -423,8 +512,14 @@ void initialize_bitboards(void)
 				board.pawn_count[color]++;
 			else
 				board.piece_count[color]++;
+			board.piece_type_count[piece]++;
 			if (piece != KING)
+			{
 				board.material[color] += piece_value[piece];
+				board.psq_opening[color] +=
+					piece_square_value[color][piece][square];
+				board.psq_endgame[color] += piece_endgame_value[piece];
+			}
 		}
 	}
 
@@ -432,6 +527,9 @@ void initialize_bitboards(void)
 		board.color_bb[WHITE]);
 	board.king_square[BLACK] = first_square(board.piece_bb[KING] &
 		board.color_bb[BLACK]);
+
+	refresh_features(WHITE);
+	refresh_features(BLACK);
 }
 
 /**
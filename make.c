@@ -21,13 +21,36 @@
 #include "functions.h"
 #include "globals.h"
 #include "eval.h"
+#include "profile.h"
 
 /**
 make_move():
-Makes the given move on the internal board.
-Created 070305; last modified 050408
+Makes the given move on the internal board. If the move leaves the king in
+check, it is taken back and FALSE is returned.
+Created 070305; last modified 101926
 **/
 BOOL make_move(MOVE move)
+{
+	make_legal_move(move);
+
+	/* Check legality. */
+	if (move != NULL_MOVE &&
+		is_attacked(board.king_square[board.side_ntm], board.side_tm))
+	{
+		unmake_move();
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+make_legal_move():
+Makes the given move on the internal board, without checking if it leaves the
+king in check. This is for moves that are known to be legal, such as those from
+generate_legal() or those that passed move_is_legal().
+Created 101926; last modified 101926
+**/
+void make_legal_move(MOVE move)
 {
 	PIECE cap;
 	PIECE piece;
@@ -37,7 +60,9 @@ BOOL make_move(MOVE move)
 	SQUARE to;
 	SQUARE castle_from;
 	SQUARE castle_to;
+	PROFILE_DECLARE(profile_start)
 
+	PROFILE_START(profile_start);
 	/* Back up game info for undoing this move. */
 	board.game_entry->move = move;
 	board.game_entry->ep_square = board.ep_square;
@@ -46,6 +71,10 @@ BOOL make_move(MOVE move)
 	board.game_entry->hashkey = board.hashkey;
 	board.game_entry->path_hashkey = board.path_hashkey;
 	board.game_entry->pawn_hashkey = board.pawn_entry.hashkey;
+	board.game_entry->feature_acc[WHITE][0] = board.feature_acc[WHITE][0];
+	board.game_entry->feature_acc[WHITE][1] = board.feature_acc[WHITE][1];
+	board.game_entry->feature_acc[BLACK][0] = board.feature_acc[BLACK][0];
+	board.game_entry->feature_acc[BLACK][1] = board.feature_acc[BLACK][1];
 
 	if (board.side_tm == BLACK)
 		board.move_number++;
@@ -63,7 +92,8 @@ BOOL make_move(MOVE move)
 		board.side_ntm = COLOR_FLIP(board.side_ntm);
 		board.game_entry->capture = EMPTY;
 		board.game_entry++;
-		return TRUE;
+		PROFILE_STOP(PROFILE_MAKE_MOVE, profile_start);
+		return;
 	}
 
 	from = MOVE_FROM(move);
@@ -90,6 +120,10 @@ BOOL make_move(MOVE move)
 		CLEAR_BIT(board.color_bb[board.side_ntm], to);
 		CLEAR_BIT(board.piece_bb[cap], to); 
 		board.material[board.side_ntm] -= piece_value[cap];
+		board.psq_opening[board.side_ntm] -=
+			piece_square_value[board.side_ntm][cap][to];
+		board.psq_endgame[board.side_ntm] -= piece_endgame_value[cap];
+		board.piece_type_count[cap]--;
 		board.hashkey ^= zobrist_piece[board.side_ntm][cap][to];
 		if (cap == PAWN)
 		{
@@ -112,6 +146,10 @@ BOOL make_move(MOVE move)
 	board.piece[to] = piece;
 	board.hashkey ^= zobrist_piece[board.side_tm][piece][from];
 	board.hashkey ^= zobrist_piece[board.side_tm][piece][to];
+	if (piece != KING)
+		board.psq_opening[board.side_tm] +=
+			piece_square_value[board.side_tm][piece][to] -
+			piece_square_value[board.side_tm][piece][from];
 
 	/* Pawn moves require some extra handling. */
 	if (piece == PAWN)
@@ -141,6 +179,10 @@ BOOL make_move(MOVE move)
 				board.piece[ep_square] = EMPTY;
 				board.pawn_count[board.side_ntm]--;
 				board.material[board.side_ntm] -= piece_value[PAWN];
+				board.psq_opening[board.side_ntm] -=
+					piece_square_value[board.side_ntm][PAWN][ep_square];
+				board.psq_endgame[board.side_ntm] -= piece_endgame_value[PAWN];
+				board.piece_type_count[PAWN]--;
 				board.hashkey ^= zobrist_piece[board.side_ntm][PAWN][ep_square];
 				board.pawn_entry.hashkey ^=
 					zobrist_piece[board.side_ntm][PAWN][ep_square];
@@ -155,6 +197,13 @@ BOOL make_move(MOVE move)
 				board.piece_count[board.side_tm]++;
 				board.material[board.side_tm] +=
 					piece_value[promote] - piece_value[PAWN];
+				board.psq_opening[board.side_tm] +=
+					piece_square_value[board.side_tm][promote][to] -
+					piece_square_value[board.side_tm][PAWN][to];
+				board.psq_endgame[board.side_tm] +=
+					piece_endgame_value[promote] - piece_endgame_value[PAWN];
+				board.piece_type_count[PAWN]--;
+				board.piece_type_count[promote]++;
 				board.hashkey ^= zobrist_piece[board.side_tm][PAWN][to];
 				board.hashkey ^= zobrist_piece[board.side_tm][promote][to];
 				board.pawn_entry.hashkey ^=
@@ -194,22 +243,20 @@ BOOL make_move(MOVE move)
 				board.piece[castle_to] = ROOK;
 				board.hashkey ^= zobrist_piece[board.side_tm][ROOK][castle_from];
 				board.hashkey ^= zobrist_piece[board.side_tm][ROOK][castle_to];
+				board.psq_opening[board.side_tm] +=
+					piece_square_value[board.side_tm][ROOK][castle_to] -
+					piece_square_value[board.side_tm][ROOK][castle_from];
 			}
 		}
 	}
 	board.hashkey ^= zobrist_ep[board.ep_square];
 
-	/* Check legality. */
-	if (in_check())
-	{
-		board.side_tm = board.side_ntm;
-		board.side_ntm = COLOR_FLIP(board.side_ntm);
-		unmake_move();
-		return FALSE;
-	}
+	if (zct->feature_eval)
+		update_features(move, piece, cap);
+
 	board.side_tm = board.side_ntm;
 	board.side_ntm = COLOR_FLIP(board.side_ntm);
-	return TRUE;
+	PROFILE_STOP(PROFILE_MAKE_MOVE, profile_start);
 }
 
 /**
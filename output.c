@@ -587,7 +587,7 @@ char *search_block_string(SEARCH_BLOCK *sb)
 search_state_string():
 Returns the string representation of a search state type. This is used in
 debugging the iterative search.
-Created 092307; last modified 011808
+Created 092307; last modified 101926
 **/
 char *search_state_string(SEARCH_STATE ss)
 {
@@ -595,7 +595,8 @@ char *search_state_string(SEARCH_STATE ss)
 	{
 		"SEARCH_START", "SEARCH_NULL_1", "SEARCH_IID", "SEARCH_JOIN",
 		"SEARCH_1", "SEARCH_2", "SEARCH_3", "SEARCH_4", "QSEARCH_START",
-		"QSEARCH_1", "SEARCH_WAIT", "SEARCH_CHILD_RETURN", "SEARCH_RETURN"
+		"QSEARCH_1", "SEARCH_WAIT", "SEARCH_CHILD_RETURN", "SEARCH_ROOT_RETURN",
+		"SEARCH_RETURN"
 	};
 
 	return search_state_str[ss];
@@ -650,6 +651,31 @@ void display_search_line(BOOL final, MOVE *pv, VALUE value)
 	}
 }
 
+/**
+display_multi_pv():
+In MultiPV mode, prints each of the best lines found so far, best first. The
+lines are passed as root moves, each with its PV and exact score.
+Created 101926; last modified 101926
+**/
+void display_multi_pv(BOOL final, ROOT_MOVE **line, int line_count)
+{
+	int x;
+
+	sum_counters();
+	if (zct->protocol == UCI)
+	{
+		if (zct->post && zct->nodes + zct->q_nodes > zct->output_limit)
+			for (x = 0; x < line_count; x++)
+				print("info multipv %i depth %i seldepth %i score %V time %i "
+					"nodes %L pv %lM\n", x + 1, zct->current_iteration,
+					zct->max_depth_reached, line[x]->last_score, time_used(),
+					zct->nodes + zct->q_nodes, line[x]->pv);
+	}
+	else
+		for (x = 0; x < line_count; x++)
+			display_search_line(final, line[x]->pv, line[x]->last_score);
+}
+
 /**
 display_search_header():
 At the beginning of a search, if we're in console mode, print out a little
@@ -73,18 +73,21 @@ BITBOARD perft(int depth, MOVE *first_move)
 /**
 perft_hash_lookup():
 Probe the hash table for a subtree value with the same depth that might have been computed before.
-Created 100406; last modified 081607
+Created 100406; last modified 101926
 **/
 BITBOARD perft_hash_lookup(int depth)
 {
 	int x;
 	HASH_ENTRY *entry;
+	BITBOARD data;
 
 	entry = &zct->hash_table[board.hashkey % zct->hash_size];
 	for (x = 0; x < HASH_SLOT_COUNT; x++)
 	{
-		if (entry->entry[x].hashkey == board.hashkey && (entry->entry[x].data & 63) == depth)
-			return entry->entry[x].data >> 6;
+		data = entry->entry[x].data;
+		if (HASH_SLOT_MATCH(entry->entry[x].check, data, board.hashkey) &&
+			(data & 63) == depth)
+			return (data & ~SET_HASH_KEY(~(HASHKEY)0)) >> 6;
 	}
 	return 0;
 }
@@ -92,8 +95,8 @@ BITBOARD perft_hash_lookup(int depth)
 /**
 perft_hash_store():
 Store the results of a perft search into the hash table. This stores a hashkey, depth counter and
-64 bit perft subtree count.
-Created 100406; last modified 081607
+45 bit perft subtree count.
+Created 100406; last modified 101926
 **/
 void perft_hash_store(int depth, BITBOARD nodes)
 {
@@ -113,6 +116,9 @@ void perft_hash_store(int depth, BITBOARD nodes)
 			best_depth = entry->entry[x].data & 63;
 		}
 	}
-	entry->entry[best_entry].data = depth | (nodes << 6);
-	entry->entry[best_entry].hashkey = board.hashkey;
+	/* The node count shares the data word with the upper hashkey bits. */
+	nodes = depth | (nodes << 6 & ~SET_HASH_KEY(~(HASHKEY)0)) |
+		SET_HASH_KEY(board.hashkey);
+	entry->entry[best_entry].data = nodes;
+	entry->entry[best_entry].check = HASH_CHECK(board.hashkey, nodes);
 }
@@ -32,13 +32,11 @@ PGN_DATABASE pgn_database;
 pgn_open():
 pgn_open opens a .pgn file and reads all games into the internal database.
 The number of games found is returned.
-Created 091407; last modified 091607
+Created 091407; last modified 101926
 **/
 int pgn_open(char *file_name)
 {
 	char buffer[BUFSIZ];
-	char *c;
-	char *b;
 	int games;
 	long last_offset;
 	PGN_GAME *game;
@@ -102,32 +100,7 @@ int pgn_open(char *file_name)
 			case HEADERS:
 				if (buffer[0] == '[')
 				{
-					c = strtok(buffer, "\"");
-					if (c == NULL)
-						continue;
-					c = strtok(buffer + strlen(c) + 1, "\"");
-					if (c == NULL)
-						continue;
-					b = strtok(buffer + 1, " =\"");
-					if (!strcmp(b, "Event"))
-						strcpy(game->tag.event, c);
-					if (!strcmp(b, "Site"))
-						strcpy(game->tag.site, c);
-					if (!strcmp(b, "Date"))
-						strcpy(game->tag.date, c);
-					if (!strcmp(b, "Round"))
-						strcpy(game->tag.round, c);
-					if (!strcmp(b, "White"))
-						strcpy(game->tag.white, c);
-					if (!strcmp(b, "Black"))
-						strcpy(game->tag.black, c);
-					if (!strcmp(b, "Result"))
-						strcpy(game->tag.result, c);
-					if (!strcmp(b, "FEN"))
-					{
-						strcpy(game->tag.fen, c);
-						initialize_board(c);
-					}
+					pgn_parse_tag(buffer, game);
 					continue;
 				}
 				state = MOVES;
@@ -144,20 +117,113 @@ int pgn_open(char *file_name)
 	return games;
 }
 
+/**
+pgn_parse_tag():
+Parses a PGN tag line, and stores the value in the game if it's a tag that we
+keep track of.
+Created 101926; last modified 101926
+**/
+void pgn_parse_tag(char *buffer, PGN_GAME *game)
+{
+	char *c;
+	char *b;
+
+	c = strtok(buffer, "\"");
+	if (c == NULL)
+		return;
+	c = strtok(buffer + strlen(c) + 1, "\"");
+	if (c == NULL)
+		return;
+	b = strtok(buffer + 1, " =\"");
+	if (!strcmp(b, "Event"))
+		strcpy(game->tag.event, c);
+	if (!strcmp(b, "Site"))
+		strcpy(game->tag.site, c);
+	if (!strcmp(b, "Date"))
+		strcpy(game->tag.date, c);
+	if (!strcmp(b, "Round"))
+		strcpy(game->tag.round, c);
+	if (!strcmp(b, "White"))
+		strcpy(game->tag.white, c);
+	if (!strcmp(b, "Black"))
+		strcpy(game->tag.black, c);
+	if (!strcmp(b, "Result"))
+		strcpy(game->tag.result, c);
+	if (!strcmp(b, "FEN"))
+	{
+		strcpy(game->tag.fen, c);
+		initialize_board(c);
+	}
+}
+
+/**
+pgn_parse_moves():
+Parses a line of PGN move text, making each move on the board and calling
+pos_func after it. Returns PGN_GAME_OVER when the end of the game is reached,
+and PGN_STOP if pos_func asks to stop.
+Created 101926; last modified 101926
+**/
+PGN_RESULT pgn_parse_moves(char *buffer, int *braces, POS_DATA *pos_data,
+	POS_FUNC pos_func, void *pos_arg)
+{
+	char move_buf[8];
+	char flag_buf[8];
+	int consumed;
+	int x;
+
+	/* Read the next line of input. Strip out all of the unneeded
+		characters. */
+	set_cmd_input(buffer);
+	cmd_parse(" \t.+#\r\n");
+	for (x = 0; x < cmd_input.arg_count; x++)
+	{
+		if (strchr(cmd_input.arg[x], '{'))
+			(*braces)++;
+		 if (strchr(cmd_input.arg[x], '}'))
+			(*braces)--;
+		else if (*braces == 0)
+		{
+			/* Pull out any flags in the move string and separate them. */
+			consumed = sscanf(cmd_input.arg[x], "%8[^?!=]%8[?!=]",
+				move_buf, flag_buf);
+			if (consumed == 2)
+				strcpy(pos_data->flags, flag_buf);
+			else
+				strcpy(pos_data->flags, "");
+
+			/* Check if we have a valid move. If so, make it and call
+				pos_func. */
+			if (input_move(move_buf, INPUT_CHECK_MOVE))
+			{
+				input_move(move_buf, INPUT_USER_MOVE);
+				/* Now execute the pos_func, which does any processing for
+					this move, for example the book making routine which
+					collects statistics. */
+				if (pos_func != NULL)
+					if (pos_func(pos_arg, pos_data))
+						return PGN_STOP;
+			}
+			/* Check for end-of-game. */
+			else if (!strcmp(cmd_input.arg[x], "1-0") ||
+				!strcmp(cmd_input.arg[x], "0-1") ||
+				!strcmp(cmd_input.arg[x], "1/2-1/2") ||
+				!strcmp(cmd_input.arg[x], "*"))
+				return PGN_GAME_OVER;
+		}
+	}
+	return PGN_CONTINUE;
+}
+
 /**
 pgn_load():
 pgn_load loads a specific game from the opened pgn database. The board
 position is set to the last position in the game.
-Created 091407; last modified 111208
+Created 091407; last modified 101926
 **/
 void pgn_load(int game_number, POS_FUNC pos_func, void *pos_arg)
 {
 	char buffer[BUFSIZ];
-	char move_buf[8];
-	char flag_buf[8];
-	int consumed;
 	int braces;
-	int x;
 	POS_DATA pos_data;
 	PGN_GAME *game;
 	PGN_STATE state;
@@ -218,52 +284,97 @@ void pgn_load(int game_number, POS_FUNC pos_func, void *pos_arg)
 					continue;
 				state = MOVES;
 			case MOVES:
-				/* Read the next line of input. Strip out all of the
-					unneeded characters. */
-				set_cmd_input(buffer);
-				cmd_parse(" \t.+#\r\n");
-				for (x = 0; x < cmd_input.arg_count; x++)
-				{
-					if (strchr(cmd_input.arg[x], '{'))
-						braces++;
-					 if (strchr(cmd_input.arg[x], '}'))
-						braces--;
-					else if (braces == 0)
-					{
-						/* Pull out any flags in the move string and separate
-							them. */
-						consumed = sscanf(cmd_input.arg[x], "%8[^?!=]%8[?!=]",
-							move_buf, flag_buf);
-						if (consumed == 2)
-							strcpy(pos_data.flags, flag_buf);
-						else
-							strcpy(pos_data.flags, "");
+				if (pgn_parse_moves(buffer, &braces, &pos_data, pos_func,
+					pos_arg) != PGN_CONTINUE)
+					goto end;
+		}
+	}
+	/* Look at the spaghetti code! How unreadable! ;) */
+end:
+	zct->notation = old_notation;
+}
+
+/**
+pgn_stream():
+Reads through every game in a PGN file in one pass, without building the
+game database, calling pos_func after each move like pgn_load(). This is for
+files that are too big to index. pos_func can return TRUE to stop reading the
+file entirely. The number of games read is returned, or -1 if the file can't
+be opened.
+Created 101926; last modified 101926
+**/
+int pgn_stream(char *file_name, POS_FUNC pos_func, void *pos_arg)
+{
+	char buffer[BUFSIZ];
+	int braces;
+	int games;
+	FILE *file;
+	POS_DATA pos_data;
+	PGN_GAME game;
+	PGN_STATE state;
+	NOTATION old_notation;
 
-						/* Check if we have a valid move. If so, make it
-							and call pos_func. */
-						if (input_move(move_buf, INPUT_CHECK_MOVE))
-						{
-							input_move(move_buf, INPUT_USER_MOVE);
-							/* Now execute the pos_func, which does any
-								processing for this move, for example the book
-								making routine which collects statistics. */
-							if (pos_func != NULL)
-								if (pos_func(pos_arg, &pos_data))
-									goto end;
-						}
-						/* Check for end-of-game. */
-						else if (!strcmp(cmd_input.arg[x], "1-0") ||
-							!strcmp(cmd_input.arg[x], "0-1") ||
-							!strcmp(cmd_input.arg[x], "1/2-1/2") ||
-							!strcmp(cmd_input.arg[x], "*"))
-							goto end;
-					}
+	if ((file = fopen(file_name, "rt")) == NULL)
+	{
+		print("%s: file not found.\n", file_name);
+		return -1;
+	}
+
+	old_notation = zct->notation;
+	zct->notation = SAN;
+	pos_data.type = POS_PGN;
+	pos_data.pgn = &game;
+	games = 0;
+	braces = 0;
+	state = NEUTRAL;
+	while (fgets(buffer, sizeof(buffer), file))
+	{
+		switch (state)
+		{
+			case NEUTRAL:
+				/* Stupid macros need an int cast... sigh */
+				if (isspace((int)buffer[0]))
+					continue;
+				/* A new game: clear out the tags and the board. */
+				memset(&game, 0, sizeof(game));
+				initialize_board(NULL);
+				zct->zct_side = EMPTY;
+				braces = 0;
+				games++;
+				state = HEADERS;
+			case HEADERS:
+				if (buffer[0] == '[')
+				{
+					pgn_parse_tag(buffer, &game);
+					continue;
+				}
+				state = MOVES;
+			case MOVES:
+				/* Some PGNs don't end games with a result, so a tag means
+					the start of the next one. */
+				if (buffer[0] == '[')
+				{
+					state = NEUTRAL;
+					fseek(file, -(long)strlen(buffer), SEEK_CUR);
+					continue;
+				}
+				switch (pgn_parse_moves(buffer, &braces, &pos_data, pos_func,
+					pos_arg))
+				{
+					case PGN_CONTINUE:
+						break;
+					case PGN_GAME_OVER:
+						state = NEUTRAL;
+						break;
+					case PGN_STOP:
+						goto end;
 				}
 		}
 	}
-	/* Look at the spaghetti code! How unreadable! ;) */
 end:
+	fclose(file);
 	zct->notation = old_notation;
+	return games;
 }
 
 /**
@@ -50,6 +50,8 @@ typedef struct
 
 /* A state for the PGN-parsing finite state machine. */
 typedef enum { NEUTRAL, HEADERS, MOVES } PGN_STATE;
+/* The result of parsing a line of moves. */
+typedef enum { PGN_CONTINUE, PGN_GAME_OVER, PGN_STOP } PGN_RESULT;
 
 /* EPD definitions */
 typedef enum { EPD_BEST_MOVE, EPD_AVOID_MOVE } EPD_TYPE;
@@ -80,7 +82,11 @@ typedef struct
 typedef BOOL (*POS_FUNC)(void *arg, POS_DATA *pos);
 
 /* Prototypes */
+void pgn_parse_tag(char *buffer, PGN_GAME *game);
+PGN_RESULT pgn_parse_moves(char *buffer, int *braces, POS_DATA *pos_data,
+	POS_FUNC pos_func, void *pos_arg);
 void pgn_load(int game_number, POS_FUNC pos_func, void *pos_arg);
+int pgn_stream(char *file_name, POS_FUNC pos_func, void *pos_arg);
 int epd_load(char *filename, POS_FUNC pos_func, void *pos_arg);
 
 #endif /* PGN_H */
@@ -0,0 +1,157 @@
+/** ZCT/profile.c--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+#include "functions.h"
+#include "globals.h"
+#include "smp.h"
+#include "profile.h"
+
+#ifdef USE_PROFILE
+/* The counters for each processor. These are in shared memory, so that the
+	master can add them up. */
+PROFILE_COUNTER (*profile_data)[PROFILE_COUNT];
+THREAD_LOCAL BITBOARD profile_return;
+/* The counters for each iteration, summed over all processors, and the sums at
+	the end of the last iteration, so that we can find the difference. */
+PROFILE_COUNTER profile_by_iteration[MAX_PLY][PROFILE_COUNT];
+PROFILE_COUNTER profile_mark[PROFILE_COUNT];
+
+static char profile_helper_str[][32] =
+{
+	"hash_probe", "evaluate", "select_move", "select_qsearch_move", "see",
+	"see_ge", "make_move"
+};
+#endif
+
+/**
+initialize_profile():
+Allocates the profile counters for each processor.
+Created 101926; last modified 101926
+**/
+void initialize_profile(void)
+{
+#ifdef USE_PROFILE
+#if !defined(ZCT_WINDOWS) && defined(SMP)
+	profile_data = shared_alloc(MAX_CPUS * sizeof(*profile_data));
+#else
+	if ((profile_data = malloc(MAX_CPUS * sizeof(*profile_data))) == NULL)
+		fatal_error("fatal error: could not allocate profile counters");
+#endif
+	clear_profile();
+#endif
+}
+
+/**
+clear_profile():
+Zeroes out all of the profile counters.
+Created 101926; last modified 101926
+**/
+void clear_profile(void)
+{
+#ifdef USE_PROFILE
+	int x;
+	int p;
+
+	for (p = 0; p < PROFILE_COUNT; p++)
+	{
+		for (x = 0; x < MAX_CPUS; x++)
+		{
+			profile_data[x][p].cycles = 0;
+			profile_data[x][p].count = 0;
+		}
+		for (x = 0; x < MAX_PLY; x++)
+		{
+			profile_by_iteration[x][p].cycles = 0;
+			profile_by_iteration[x][p].count = 0;
+		}
+		profile_mark[p].cycles = 0;
+		profile_mark[p].count = 0;
+	}
+#endif
+}
+
+/**
+profile_iteration():
+Adds up the counters for all processors, and charges everything done since the
+last call to the given iteration.
+Created 101926; last modified 101926
+**/
+void profile_iteration(int iteration)
+{
+#ifdef USE_PROFILE
+	int x;
+	int p;
+	PROFILE_COUNTER sum;
+
+	for (p = 0; p < PROFILE_COUNT; p++)
+	{
+		sum.cycles = sum.count = 0;
+		for (x = 0; x < MAX_CPUS; x++)
+		{
+			sum.cycles += profile_data[x][p].cycles;
+			sum.count += profile_data[x][p].count;
+		}
+		profile_by_iteration[iteration][p].cycles +=
+			sum.cycles - profile_mark[p].cycles;
+		profile_by_iteration[iteration][p].count +=
+			sum.count - profile_mark[p].count;
+		profile_mark[p] = sum;
+	}
+#endif
+}
+
+/**
+print_profile():
+Prints the profile for each iteration. The percentages are of the cycles spent
+in all search states during the iteration. The helper functions are counted in
+the states that call them, so their percentages don't add up to anything.
+Created 101926; last modified 101926
+**/
+void print_profile(void)
+{
+#ifdef USE_PROFILE
+	int x;
+	int p;
+	BITBOARD total;
+	PROFILE_COUNTER *counter;
+
+	for (x = 0; x < MAX_PLY; x++)
+	{
+		total = 0;
+		for (p = 0; p <= SEARCH_RETURN; p++)
+			total += profile_by_iteration[x][p].cycles;
+		if (total == 0)
+			continue;
+
+		print("profile: iteration=%i cycles=%L\n", x, total);
+		for (p = 0; p < PROFILE_COUNT; p++)
+		{
+			counter = &profile_by_iteration[x][p];
+			if (counter->count == 0)
+				continue;
+			print("        %-20s calls=%-12L cycles=%-14L per call=%-10.1f "
+				"%5.1f%%\n", p <= SEARCH_RETURN ? search_state_string(p) :
+				profile_helper_str[p - PROFILE_HASH_PROBE], counter->count,
+				counter->cycles, (float)counter->cycles / counter->count,
+				(float)100.0 * counter->cycles / total);
+		}
+	}
+#endif
+}
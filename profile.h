@@ -0,0 +1,93 @@
+/** ZCT/profile.h--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+
+#ifndef	PROFILE_H
+#define PROFILE_H
+
+/* The search profiler counts the calls and the time stamp counter cycles spent
+	in each state of search(), and in the helper functions it calls. Helper
+	times are inclusive, so they are also counted in the states that call
+	them. When USE_PROFILE isn't defined, all of this compiles to nothing. */
+//#define USE_PROFILE
+
+/* The profiled code is the search states, followed by the helper functions. */
+typedef enum { PROFILE_HASH_PROBE = SEARCH_RETURN + 1, PROFILE_EVALUATE,
+	PROFILE_SELECT_MOVE, PROFILE_SELECT_QSEARCH_MOVE, PROFILE_SEE,
+	PROFILE_SEE_GE, PROFILE_MAKE_MOVE, PROFILE_COUNT } PROFILE_ID;
+
+typedef struct
+{
+	BITBOARD cycles;
+	BITBOARD count;
+} PROFILE_COUNTER;
+
+#ifdef USE_PROFILE
+
+#	ifdef SMP
+#		define PROFILE_SELF			(board.id)
+#	else
+#		define PROFILE_SELF			(0)
+#	endif
+
+#	ifdef ZCT_WINDOWS
+#		include <intrin.h>
+#		define read_tsc()			((BITBOARD)__rdtsc())
+#	else
+static __inline__ BITBOARD read_tsc(void)
+{
+	unsigned int lo;
+	unsigned int hi;
+
+	asm __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (BITBOARD)hi << 32 | lo;
+}
+#	endif
+
+/* PROFILE_DECLARE() is used without a semicolon, as it expands to nothing when
+	the profiler is off. PROFILE_RETURN() evaluates the return value before
+	stopping the clock, so calls made in the return expression are counted. */
+#	define PROFILE_DECLARE(t)		BITBOARD t;
+#	define PROFILE_START(t)			((t) = read_tsc())
+#	define PROFILE_STOP(p, t) \
+		(profile_data[PROFILE_SELF][p].cycles += read_tsc() - (t), \
+		profile_data[PROFILE_SELF][p].count++)
+#	define PROFILE_RETURN(p, t, r) \
+		return (profile_return = (r), PROFILE_STOP(p, t), profile_return)
+
+extern PROFILE_COUNTER (*profile_data)[PROFILE_COUNT];
+extern THREAD_LOCAL BITBOARD profile_return;
+
+#else /* USE_PROFILE */
+
+#	define PROFILE_DECLARE(t)
+#	define PROFILE_START(t)
+#	define PROFILE_STOP(p, t)
+#	define PROFILE_RETURN(p, t, r)	return (r)
+
+#endif /* USE_PROFILE */
+
+/* prototypes */
+void initialize_profile(void);
+void clear_profile(void);
+void profile_iteration(int iteration);
+void print_profile(void);
+
+#endif /* PROFILE_H */
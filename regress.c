@@ -18,6 +18,8 @@
  * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "zct.h"
+#include "functions.h"
+#include "globals.h"
 
 typedef struct regression_test REG_TEST;
 
@@ -49,14 +51,19 @@ Regress runs a standard suite of regressive tests. These are designed to catch
 some simple and some not-so-simple errors that can creep in during regular
 modifications. These tests are designed to cover most aspects of ZCT, from
 simple bugs to errors in chess logic.
-Created 080308; last modified 082908
+Created 080308; last modified 101926
 **/
 void regress(void)
 {
 	int passed;
+	int count;
+	BOARD old_board;
 	REG_TEST *test;
 
+	/* The tests set up their own positions, so save the board. */
+	old_board = board;
 	passed = 0;
+	count = 0;
 	for (test = regression_tests; test->name != NULL; test++)
 	{
 		test->tests_performed = 0;
@@ -64,7 +71,12 @@ void regress(void)
 		test->test(test);
 		if (test->tests_passed == test->tests_performed)
 			passed++;
+		count++;
+		print("%s: %i/%i passed\n", test->name, test->tests_passed,
+			test->tests_performed);
 	}
+	print("%i/%i test suites passed\n", passed, count);
+	board = old_board;
 }
 
 void perft_test(REG_TEST *type)
@@ -89,6 +101,13 @@ void move_sort_test(REG_TEST *type)
 	};
 }
 
+/**
+see_test():
+Checks the static exchange evaluator on some positions with a known result.
+Both see() and see_ge() are tested, the latter with the exact value as the
+threshold (which must pass) and one more (which must fail).
+Created 080308; last modified 101926
+**/
 void see_test(REG_TEST *type)
 {
 	struct see_test_position
@@ -97,5 +116,42 @@ void see_test(REG_TEST *type)
 		SQUARE from;
 		SQUARE to;
 		int value;
+	} position[] =
+	{
+		/* undefended */
+		{ "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - -", E1, E5, 100 },
+		{ "4k3/8/8/3p4/4P3/8/8/4K3 w - -", E4, D5, 100 },
+		/* defended */
+		{ "4k3/8/2p5/3p4/4P3/8/8/4K3 w - -", E4, D5, 0 },
+		{ "4k3/8/2p5/3p4/4N3/8/8/4K3 w - -", E4, D5, -250 },
+		/* x-rays */
+		{ "4k3/8/2p5/3p4/4P3/8/6B1/4K3 w - -", E4, D5, 100 },
+		{ "3r2k1/3r4/8/8/8/8/3R4/3RK3 w - -", D2, D7, 500 },
+		{ "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - -", D3, E5,
+			-250 },
+		/* promotions */
+		{ "3r3k/2P5/8/8/8/8/8/4K3 w - -", C7, D8, 1400 },
+		{ "3rk3/2P5/8/8/8/8/8/4K3 w - -", C7, D8, 400 },
+		/* non-captures */
+		{ "4k3/8/8/8/8/2p5/8/3Q3K w - -", D1, D2, -1000 },
+		{ "4k3/8/8/8/8/2p5/8/3QK3 w - -", D1, D2, -900 },
+		{ NULL, OFF_BOARD, OFF_BOARD, 0 }
 	};
+	int x;
+	VALUE value;
+
+	for (x = 0; position[x].position != NULL; x++)
+	{
+		initialize_board(position[x].position);
+		value = see(position[x].to, position[x].from);
+		type->tests_performed++;
+		if (value == position[x].value &&
+			see_ge(position[x].to, position[x].from, position[x].value) &&
+			!see_ge(position[x].to, position[x].from, position[x].value + 1))
+			type->tests_passed++;
+		else
+			print("SEE test failed: %s %S%S: see=%i expected=%i\n",
+				position[x].position, position[x].from, position[x].to,
+				value, position[x].value);
+	}
 }
@@ -22,6 +22,7 @@
 #include "globals.h"
 #include "debug.h"
 #include "smp.h"
+#include "profile.h"
 
 #define SEARCH_CALL(d, p, a, b, fm, nt, ss) \
 	do { \
@@ -57,11 +58,15 @@
 /**
 search():
 Do an iterative alpha-beta search.
-Created 070905; last modified 110708
+Created 070905; last modified 101926
 **/
 VALUE search(SEARCH_BLOCK *sb)
 {
 	VALUE r;
+#ifdef USE_PROFILE
+	BITBOARD profile_start;
+	SEARCH_STATE profile_state;
+#endif
 
 	while (TRUE)
 	{
@@ -75,6 +80,10 @@ VALUE search(SEARCH_BLOCK *sb)
 #endif
 		if (search_maintenance(&sb, &r))
 			return r;
+#ifdef USE_PROFILE
+		profile_state = sb->search_state;
+		PROFILE_START(profile_start);
+#endif
 		switch (sb->search_state)
 		{
 /**
@@ -120,6 +129,19 @@ case SEARCH_START:
 				RETURN(sb->alpha);
 		}
 
+		/* Probe the bitbases. Draws are cut off right away, but wins are
+			only cut off if the root position isn't already a won bitbase
+			position, so that the search can still find the mate. */
+		if (bitbase_probe(&r) && (r == DRAW || !zct->root_bitbase))
+		{
+			zct->bitbase_hits++;
+			if (r > DRAW)
+				r -= sb->ply;
+			else if (r < DRAW)
+				r += sb->ply;
+			RETURN(r);
+		}
+
 		/* Probe the hash table. */
 		if (hash_probe(sb, FALSE))
 			RETURN(sb->alpha);
@@ -190,8 +212,10 @@ case SEARCH_START:
 				so that we don't return a false mate. */
 			if (sb->moves > 0 && move_is_futile(sb, sb->move))
 				continue;
-			if (!make_move(sb->move))
-				continue;
+			/* All moves from select_move() are legal, so we don't have to
+				test for check after making them. */
+			ASSERT(is_legal(sb->move));
+			make_legal_move(sb->move);
 			sb->moves++;
 			sb->move_made = TRUE;
 
@@ -261,9 +285,9 @@ case SEARCH_START:
 				/* Fail high. */
 				if (r >= sb->beta)
 				{
-					zct->fail_high_nodes++;
+					COUNTER_INC(fail_high_nodes);
 					if (sb->moves == 1)
-						zct->fail_high_first++;
+						COUNTER_INC(fail_high_first);
 					hash_store(sb, sb->move, r, HASH_LOWER_BOUND, FALSE);
 					RETURN(r);
 				}
@@ -309,16 +333,16 @@ case SEARCH_JOIN:
 		/* Store in the hash table, plus update some statistics/heuristics. */
 		if (sb->pv_found)
 		{
-			zct->pv_nodes++;
+			COUNTER_INC(pv_nodes);
 			if (sb->pv_found == 1)
-				zct->pv_first++;
+				COUNTER_INC(pv_first);
 			heuristic_pv(board.pv_stack[sb->ply][0], sb);
 			hash_store(sb, board.pv_stack[sb->ply][0], sb->alpha,
 				HASH_EXACT_BOUND, FALSE);
 		}
 		else
 		{
-			zct->fail_low_nodes++;
+			COUNTER_INC(fail_low_nodes);
 			hash_store(sb, NO_MOVE, sb->best_score, HASH_UPPER_BOUND, FALSE);
 		}
 		RETURN(sb->best_score);
@@ -368,14 +392,22 @@ case QSEARCH_START:
 			RETURN(sb->alpha);
 
 		sb->check = check_squares();
+		/* The eval block isn't filled in when we're in check, so make sure
+			the move ordering doesn't use stale attack maps. */
+		if (sb->check)
+		{
+			sb->eval_block.attacks[WHITE] = 0;
+			sb->eval_block.attacks[BLACK] = 0;
+		}
 		/* We can only stand pat if we're not in check. If we're in check,
 			we must search all moves (now handled in the move sorting function),
 			and we can't take the stand pat score, which is basically a null
 			move score. */
 		if (!sb->check)
 		{
-			/* Evaluate for the stand pat. */
-			evaluate(&sb->eval_block);
+			/* Evaluate for the stand pat. Only the score relative to the
+				window matters here, so the evaluation can be lazy. */
+			evaluate_lazy(&sb->eval_block, sb->alpha, sb->beta);
 			r = sb->best_score = sb->eval_block.full_eval;
 			if (r > sb->alpha)
 			{
@@ -490,6 +522,40 @@ case SEARCH_CHILD_RETURN:
 		set_idle();
 		goto end;
 
+case SEARCH_ROOT_RETURN:
+
+		/* We finished a root move taken from the shared root move table. If
+			it failed high on the zero window, search it again with the full
+			window from the current alpha. */
+		ASSERT(board.game_entry == root_entry + 1);
+		r = -RETURN_VALUE;
+		if (!smp_block[board.id].root_research &&
+			r > smp_block[board.id].root_alpha &&
+			!smp_data->root_split.fail_high)
+		{
+			smp_block[board.id].root_research = TRUE;
+			smp_block[board.id].root_alpha = smp_data->root_split.alpha;
+			search_call(sb, FALSE, smp_data->root_split.depth, 1,
+				-smp_data->root_split.beta, -smp_block[board.id].root_alpha,
+				&board.move_stack[0], NODE_PV, SEARCH_ROOT_RETURN);
+			sb++;
+			goto end;
+		}
+		unmake_move();
+
+		root_split_result(smp_block[board.id].root_move, r,
+			smp_block[board.id].root_research,
+			smp_block[board.id].nodes + smp_block[board.id].q_nodes -
+			smp_block[board.id].root_nodes, board.pv_stack[1]);
+		smp_block[board.id].root_move = -1;
+
+		/* Set up the search stack again and then start waiting. */
+		sb->search_state = SEARCH_CHILD_RETURN;
+		sb++;
+		sb->search_state = SEARCH_WAIT;
+		set_idle();
+		goto end;
+
 #endif
 
 /* The master process has finished searching. Presumably all other processes
@@ -505,10 +571,12 @@ case SEARCH_RETURN:
 			make_move((zct->next_root_move - 1)->move);
 #endif
 
+		PROFILE_STOP(profile_state, profile_start);
 		return RETURN_VALUE;
 
 /* Do basic node processing: time, input, and messages in SMP. */
 end:
+		PROFILE_STOP(profile_state, profile_start);
 		break;
 default:
 		fatal_error("ERROR: corrupted search_state. sb=%i\n", sb->search_state);
@@ -22,34 +22,39 @@
 #include "globals.h"
 #include "eval.h"
 #include "smp.h"
+#include "trace.h"
+
+/* History values saturate at this bound. */
+#define HISTORY_MAX		(1 << 20)
 
 /**
 heuristic():
 Updates history, killer, and counter tables based on a move that failed high.
-Created 092906; last modified 081007
+The tables can be shared with the other processors, and they are updated
+without locking. Each history entry is read and written once, so a race can
+lose an update, but it can't push the entry past HISTORY_MAX.
+Created 092906; last modified 101926
 **/
 void heuristic(MOVE best_move, SEARCH_BLOCK *sb)
 {
-	int x;
-
-	/* Update the history table. */
-	zct->history_table[board.side_tm][MOVE_KEY(best_move)] +=
-		sb->depth * sb->depth;
-	zct->history_counter = MAX(zct->history_table[board.side_tm]
-		[MOVE_KEY(best_move)], zct->history_counter);
-	/* Check for an "overflow" of the history table, in which case we scale
-		back all of the values. */
-	if (zct->history_counter > 1 << 20)
-	{
-		for (x = 0; x < 2 * 4096; x++) /* This is not recommended ;) */
-			zct->history_table[0][x] >>= 4;
-		zct->history_counter >>= 4;
-	}
+	unsigned int *entry;
+	unsigned int history;
+	unsigned int bonus;
+
+	/* Update the history table. Instead of rescaling the whole table when an
+		entry gets too large, the bonus shrinks as the entry approaches
+		HISTORY_MAX. Note that score_move() doesn't use the history scores
+		yet, so they don't affect the move ordering. */
+	entry = &heuristics->history_table[board.side_tm][MOVE_KEY(best_move)];
+	history = *entry;
+	bonus = MIN(sb->depth * sb->depth, HISTORY_MAX);
+	history += bonus - (unsigned int)((BITBOARD)history * bonus / HISTORY_MAX);
+	*entry = history;
 	/* Update killer moves. */
 	if (board.color[MOVE_TO(best_move)] == EMPTY)
 	{
-		zct->killer_move[sb->ply][1] = MOVE_COMPARE(best_move);
-		zct->counter_move[board.side_tm][MOVE_KEY((sb - 1)->move)][1] =
+		heuristics->killer_move[sb->ply][1] = MOVE_COMPARE(best_move);
+		heuristics->counter_move[board.side_tm][MOVE_KEY((sb - 1)->move)][1] =
 			MOVE_COMPARE(best_move);
 	}
 }
@@ -57,14 +62,14 @@ void heuristic(MOVE best_move, SEARCH_BLOCK *sb)
 /**
 heuristic_pv():
 Updates killer tables when the pv changes at a pv node.
-Created 110606; last modified 081007
+Created 110606; last modified 101926
 **/
 void heuristic_pv(MOVE best_move, SEARCH_BLOCK *sb)
 {
 	if (board.color[MOVE_TO(best_move)] == EMPTY)
 	{
-		zct->killer_move[sb->ply][0] = MOVE_COMPARE(best_move);
-		zct->counter_move[board.side_tm][MOVE_KEY((sb - 1)->move)][0] =
+		heuristics->killer_move[sb->ply][0] = MOVE_COMPARE(best_move);
+		heuristics->counter_move[board.side_tm][MOVE_KEY((sb - 1)->move)][0] =
 			MOVE_COMPARE(best_move);
 	}
 }
@@ -132,7 +137,7 @@ extend_move():
 Calculates the search extension to be awarded to the given move. This is based
 on various information such as whether the move checks, if it is a threat or
 not, etc. This also determines whether a move should be reduced or not.
-Created 072007; last modified 081808
+Created 072007; last modified 101926
 **/
 int extend_move(SEARCH_BLOCK *sb)
 {
@@ -147,20 +152,20 @@ int extend_move(SEARCH_BLOCK *sb)
 		if (in_check())
 		{
 			extension += zct->check_extension;
-			zct->check_extensions_done++;
+			COUNTER_INC(check_extensions_done);
 		}
 		/* one-reply extension */
 		if (sb->check && sb->last_move - sb->first_move == 1)
 		{
 			extension += zct->one_rep_extension;
-			zct->one_rep_extensions_done++;
+			COUNTER_INC(one_rep_extensions_done);
 		}
 		/* pawn to 7th extension */
 		if (board.piece[MOVE_TO(sb->move)] == PAWN &&
 			RANK_OF(SQ_FLIP_COLOR(MOVE_TO(sb->move), board.side_ntm)) == RANK_7)
 		{
 			extension += zct->passed_pawn_extension;
-			zct->passed_pawn_extensions_done++;
+			COUNTER_INC(passed_pawn_extensions_done);
 		}
 		extension = MIN(PLY, extension);
 	}
@@ -200,7 +205,7 @@ extend_node():
 Calculate a new depth for this node, based on extensions, reductions, and any
 possible pruning. This is done after eval, null move, and IID, so we have
 some information to go on.
-Created 081808; last modified 081808
+Created 081808; last modified 101926
 **/
 void extend_node(SEARCH_BLOCK *sb)
 {
@@ -265,7 +270,7 @@ void extend_node(SEARCH_BLOCK *sb)
 	if (sb->threat)
 	{
 		sb->depth += zct->threat_extension;
-		zct->threat_extensions_done++;
+		COUNTER_INC(threat_extensions_done);
 	}
 	/* XXX what to do now? Ideas:
 		--"refuting" lmr based on eval
@@ -287,7 +292,7 @@ void extend_node(SEARCH_BLOCK *sb)
 /**
 search_call():
 Sets up the internal stack for a search call.
-Created 081205; last modified 081908
+Created 081205; last modified 101926
 **/
 void search_call(SEARCH_BLOCK *sb, BOOL is_qsearch, int depth, int ply,
 	VALUE alpha, VALUE beta, MOVE *first_move, NODE_TYPE node_type,
@@ -325,6 +330,8 @@ void search_call(SEARCH_BLOCK *sb, BOOL is_qsearch, int depth, int ply,
 	sb->first_move = first_move;
 	sb->next_move = first_move;
 	sb->last_move = first_move;
+	sb->next_bad_cap = first_move;
+	sb->last_bad_cap = first_move;
 
 	sb->hash_move = NO_MOVE;
 	sb->move = NO_MOVE;
@@ -333,17 +340,22 @@ void search_call(SEARCH_BLOCK *sb, BOOL is_qsearch, int depth, int ply,
 
 	sb->is_qsearch = is_qsearch;
 	sb->move_made = FALSE;
+
+	if (zct->trace)
+		trace_call(sb);
 }
 
 /**
 search_return():
 In the iterative search framework, this function handles some bookkeeping
 involved in backing up a value.
-Created 110108; last modified 110108
+Created 110108; last modified 101926
 **/
 void search_return(SEARCH_BLOCK *sb, VALUE return_value)
 {
 	sb->return_value = return_value;
+	if (zct->trace)
+		trace_return(sb, return_value);
 #ifdef SMP
 	if (sb > board.search_stack)
 		update_best_sb(sb - 1, FALSE);
@@ -367,10 +379,11 @@ search_maintenance():
 In every node during a search, do some checks for SMP events, timeout, etc.
 If the search needs to exit, we store the return value in return_value and
 return TRUE, otherwise we return FALSE.
-Created 031609; last modified 031609
+Created 031609; last modified 101926
 **/
 BOOL search_maintenance(SEARCH_BLOCK **sb, VALUE *return_value)
 {
+	BOOL abort_root;
 #ifdef SMP
 	int r;
 
@@ -388,6 +401,14 @@ BOOL search_maintenance(SEARCH_BLOCK **sb, VALUE *return_value)
 		}
 	}
 
+	/* If the root has failed high while we are searching a root move in
+		parallel, our move can't matter anymore, so drop it. */
+	if (smp_block[board.id].root_move != -1 && smp_data->root_split.fail_high)
+	{
+		root_split_abort(sb);
+		return FALSE;
+	}
+
 	/* If another processor has backed up to the root, they set a flag
 	   because only the main processor can return to search_root(). */
 	if (board.id == 0 && smp_data->return_flag)
@@ -412,10 +433,32 @@ BOOL search_maintenance(SEARCH_BLOCK **sb, VALUE *return_value)
 		*return_value = smp_data->return_value;
 		return TRUE;
 	}
+
+	/* The main processor waits in the search while the root moves searched
+		in parallel are finished. Once they all are, go back to
+		root_split_search(). */
+	if (board.id == 0 && smp_data->root_split.waiting &&
+		smp_data->root_split.outstanding == 0 &&
+		(*sb)->search_state == SEARCH_WAIT)
+	{
+		*return_value = 0;
+		return TRUE;
+	}
+
+	/* If a helper has failed high at the root while we are searching one of
+		the root moves ourselves, our move can't matter anymore. Stop the
+		search just like for a timeout, and mark the root split as inactive so
+		root_split_search() knows our move wasn't finished. */
+	abort_root = (board.id == 0 && smp_data->root_split.active &&
+		!smp_data->root_split.waiting && smp_data->root_split.fail_high);
+	if (abort_root)
+		smp_data->root_split.active = FALSE;
+#else
+	abort_root = FALSE;
 #endif
 
 	/* Do the standard periodic check for time or input. */
-	if (search_check())
+	if (abort_root || search_check())
 	{
 #ifdef SMP
 		/* Flag the other processors down. */
@@ -451,11 +494,15 @@ BOOL search_maintenance(SEARCH_BLOCK **sb, VALUE *return_value)
 search_check():
 Does a periodic check if the search has ended. Note that this "node counter"
 no longer represents nodes at all, just simply the iterations of our iterative
-search function.
-Created 122308; last modified 122308
+search function. Batch searches (see evaluate_batch()) run outside of the
+normal search and are never interrupted.
+Created 122308; last modified 101926
 **/
 BOOL search_check(void)
 {
+	if (eval_batch_mode)
+		return FALSE;
+
 #ifdef SMP
 	if (board.id != 0)
 		return FALSE;
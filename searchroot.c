@@ -23,30 +23,43 @@
 #include "debug.h"
 #include "eval.h"
 #include "smp.h"
+#include "profile.h"
+#include "trace.h"
 
 int idle_time;
 
 /**
 search_root():
 Do an alpha-beta search at the root. This routine also implements iterative
-deepening.
-Created 091505; last modified 031709
+deepening and aspiration windows, and the optional parallel search of the
+root moves after the first. In MultiPV mode, the best zct->multi_pv moves are
+searched with exact windows, and the rest are searched against the score of
+the worst of those lines.
+Created 091505; last modified 101926
 **/
 void search_root(void)
 {
 	VALUE alpha;
 	VALUE beta;
 	VALUE value;
+	VALUE last_score;
+	VALUE root_alpha;
 	BITBOARD last_nodes;
 	ROOT_MOVE *move;
+	ROOT_MOVE *line[MAX_ROOT_MOVES];
+	int line_count;
 	int depth;
+	int delta;
+	int x;
 
 	clear_search();
 
-	/* Probe the book. If we get a hit, we don't have to search. */
-	if (zct->use_book && zct->engine_state != ANALYZING &&
-		zct->engine_state != PONDERING && zct->engine_state != INFINITE &&
-		zct->engine_state != DEBUGGING && book_probe())
+	/* Probe the book. If we get a hit, we don't have to search. The book
+		doesn't know about the search moves, so don't use it if we have any. */
+	if (zct->use_book && zct->search_move_count == 0 &&
+		zct->engine_state != ANALYZING && zct->engine_state != PONDERING &&
+		zct->engine_state != INFINITE && zct->engine_state != DEBUGGING &&
+		book_probe())
 		return;
 
 	initialize_search();
@@ -56,8 +69,25 @@ void search_root(void)
 	/* The main iterative deepening loop. */
 	for (zct->current_iteration = 1; ; zct->current_iteration++)
 	{
-		alpha = -MATE;
-		beta = MATE;
+		/* Set up the aspiration window around the score from the last
+			iteration. Mate scores, the first iteration, and MultiPV searches
+			get a full window. */
+		delta = zct->aspiration_window;
+		last_score = zct->best_score_by_depth[zct->current_iteration - 1];
+		if (zct->current_iteration > 1 && delta > 0 && zct->multi_pv == 1 &&
+			ABS(last_score) < MATE - MAX_PLY)
+		{
+			root_alpha = MAX(last_score - delta, -MATE);
+			beta = MIN(last_score + delta, MATE);
+		}
+		else
+		{
+			root_alpha = -MATE;
+			beta = MATE;
+		}
+research:
+		alpha = root_alpha;
+		line_count = 0;
 		zct->next_root_move = &zct->root_move_list[0];
 		while ((move = select_root_move()) != NULL)
 		{
@@ -66,9 +96,9 @@ void search_root(void)
 
 			depth = (zct->current_iteration - 1) * PLY;
 			/* Set up the iterative search stack and call the search. */
-			if (alpha > -MATE)
+			if (line_count >= zct->multi_pv)
 			{
-				/* Zero window on moves after the first. */
+				/* Zero window once we have all of our lines. */
 				search_call(&board.search_stack[0], FALSE,
 					depth, 1, -alpha - 1, -alpha,
 					&board.move_stack[0], NODE_PV, SEARCH_RETURN);
@@ -107,8 +137,30 @@ void search_root(void)
 			copy_pv(move->pv + 1, board.pv_stack[1]);
 
 			/* Update and display the new PV. */
-			if (value > alpha)
+			if (value > alpha && zct->multi_pv > 1)
+			{
+				/* Insert the move into the sorted list of lines, dropping the
+					last line if the list is full. Once it is full, alpha is the
+					score of the worst line. */
+				if (line_count < zct->multi_pv)
+					line_count++;
+				for (x = line_count - 1;
+					x > 0 && line[x - 1]->last_score < value; x--)
+					line[x] = line[x - 1];
+				line[x] = move;
+				if (x == 0)
+				{
+					zct->best_score_by_depth[zct->current_iteration] = value;
+					zct->pv_changes_by_depth[zct->current_iteration]++;
+					copy_pv(board.pv_stack[0], move->pv);
+				}
+				if (line_count == zct->multi_pv)
+					alpha = line[line_count - 1]->last_score;
+				display_multi_pv(FALSE, line, line_count);
+			}
+			else if (value > alpha)
 			{
+				line_count = 1;
 				alpha = value;
 				move->score = ++zct->root_pv_counter;
 				zct->best_score_by_depth[zct->current_iteration] = alpha;
@@ -121,10 +173,61 @@ void search_root(void)
 
 			if (stop_search() || zct->current_iteration == MAX_PLY)
 				goto done;
+
+			/* Check for aspiration window failures. On a fail high, the move
+				is now ordered first, so the iteration is searched again from
+				the start with a wider window above. On a fail low of the first
+				move, the window is widened below. We record the (upper bound)
+				score, so that the time control sees the score drop. */
+			if (value >= beta && beta < MATE)
+			{
+				zct->fail_highs_by_depth[zct->current_iteration]++;
+				delta *= 2;
+				beta = MIN(value + delta, MATE);
+				goto research;
+			}
+			else if (move == &zct->root_move_list[0] && value <= root_alpha &&
+				root_alpha > -MATE)
+			{
+				zct->fail_lows_by_depth[zct->current_iteration]++;
+				zct->best_score_by_depth[zct->current_iteration] = value;
+				delta *= 2;
+				root_alpha = MAX(value - delta, -MATE);
+				goto research;
+			}
+#ifdef SMP
+			/* With the first move searched, the rest of the root moves can be
+				handed out to the other processors. */
+			if (move == &zct->root_move_list[0] && zct->root_split &&
+				zct->multi_pv == 1 && zct->process_count > 1 &&
+				zct->engine_state != DEBUGGING)
+			{
+				if (root_split_search(depth, &alpha, beta))
+					goto done;
+				if (alpha >= beta && beta < MATE)
+				{
+					zct->fail_highs_by_depth[zct->current_iteration]++;
+					delta *= 2;
+					beta = MIN(alpha + delta, MATE);
+					goto research;
+				}
+				break;
+			}
+#endif
 		}
 		/* Add up search counters and print the PV for this iteration. */
 		sum_counters();
-		display_search_line(TRUE, board.pv_stack[0], alpha);
+		profile_iteration(zct->current_iteration);
+		if (zct->multi_pv > 1)
+		{
+			/* Order the lines first for the next iteration, best first. */
+			for (x = line_count - 1; x >= 0; x--)
+				line[x]->score = ++zct->root_pv_counter;
+			display_multi_pv(TRUE, line, line_count);
+		}
+		else
+			display_search_line(TRUE, board.pv_stack[0], alpha);
+		print_tree_stats();
 
 		/* If we're in EPD testing mode, check the move found against the
 			solution(s). */
@@ -154,21 +257,30 @@ void clear_search(void)
 /**
 initialize_search():
 Initializes all of the data needed to run a search.
-Created 031709; last modified 031709
+Created 031709; last modified 101926
 **/
 void initialize_search(void)
 {
+	VALUE value;
+
 	/* Set up counters. */
 	initialize_counters();
 
 	if (zct->engine_state != BENCHMARKING)
+	{
 		initialize_statistics();
+		clear_profile();
+	}
 
 	/* Set up root PV counter (used for move ordering). */
 	zct->root_pv_counter = 0;
 
+	/* See if we're already in a won bitbase ending. */
+	zct->root_bitbase = (bitbase_probe(&value) && value != DRAW);
+
 	root_entry = board.game_entry;
 	generate_root_moves();
+	restrict_root_moves();
 	start_time();
 	set_time_limit();
 
@@ -182,7 +294,7 @@ void initialize_search(void)
 /**
 finish_search():
 Finalizes all information for the search and cleans up some stats.
-Created 031709; last modified 031709
+Created 031709; last modified 101926
 **/
 void finish_search(void)
 {
@@ -191,6 +303,9 @@ void finish_search(void)
 	set_idle();
 #endif
 
+	/* A set of search moves only applies to one search. */
+	zct->search_move_count = 0;
+
 	/* We're in UCI infinite mode, so just wait until the UI asks us to stop. */
 	if (zct->engine_state == INFINITE)
 		while (!stop_search())
@@ -204,7 +319,10 @@ void finish_search(void)
 		zct->last_root_score =
 			zct->best_score_by_depth[zct->current_iteration];
 
-	/* Print out the final search statistics. */
+	/* Print out the final search statistics. Whatever was done in an
+		unfinished iteration is charged to it in the profile. */
+	profile_iteration(zct->current_iteration);
+	trace_flush();
 	print_search_info();
 
 	/* If this was a normal search, i.e. not a ponder search, set the
@@ -221,7 +339,7 @@ void finish_search(void)
 print_search_info():
 After the search, print out some statistics. If we're in ICS mode, kibitz some
 junk as well so everyone knows we're not cheating. (wink wink)
-Created 031709; last modified 031709
+Created 031709; last modified 101926
 **/
 void print_search_info(void)
 {
@@ -244,22 +362,32 @@ void print_search_info(void)
 			(float)100.0 * zct->q_nodes / (zct->nodes + zct->q_nodes), time,
 			(int)(1000 * (zct->nodes + zct->q_nodes) / time));
 		print("        fail highs=%-10L pv nodes=%-10L fail lows=%-10L\n",
-			zct->fail_high_nodes, zct->pv_nodes, zct->fail_low_nodes);
+			zct->counters.fail_high_nodes, zct->counters.pv_nodes,
+			zct->counters.fail_low_nodes);
 		print("        fh first=%3.1f%%        pv first=%.1f%%\n",
-			(float)100.0 * zct->fail_high_first / zct->fail_high_nodes,
-			(float)100.0 * zct->pv_first / zct->pv_nodes);
-		print("ext:    check=%i one-rep=%i threat=%i passed-pawn=%i\n",
-			zct->check_extensions_done, zct->one_rep_extensions_done,
-			zct->threat_extensions_done, zct->passed_pawn_extensions_done);
+			(float)100.0 * zct->counters.fail_high_first /
+				zct->counters.fail_high_nodes,
+			(float)100.0 * zct->counters.pv_first / zct->counters.pv_nodes);
+		print_research_counts();
+		print("ext:    check=%L one-rep=%L threat=%L passed-pawn=%L\n",
+			zct->counters.check_extensions_done,
+			zct->counters.one_rep_extensions_done,
+			zct->counters.threat_extensions_done,
+			zct->counters.passed_pawn_extensions_done);
 		print("hash:   hits=%3.1f%% cutoffs=%3.1f%% full=%3.1f%% pawn=%3.1f%% "
 			"eval=%3.1f%% qsearch=%3.1f%%\n",
-			(float)100.0 * zct->hash_hits / zct->hash_probes,
-			(float)100.0 * zct->hash_cutoffs / zct->hash_probes,
+			(float)100.0 * zct->counters.hash_hits / zct->counters.hash_probes,
+			(float)100.0 * zct->counters.hash_cutoffs /
+				zct->counters.hash_probes,
 			(float)100.0 * zct->hash_entries_full /
 				(zct->hash_size * HASH_SLOT_COUNT),
 			(float)100.0 * zct->pawn_hash_hits / zct->pawn_hash_probes,
 			(float)100.0 * zct->eval_hash_hits / zct->eval_hash_probes,
 			(float)100.0 * zct->qsearch_hash_hits / zct->qsearch_hash_probes);
+		print("eval:   full=%L lazy=%L full/node=%.3f bitbase hits=%L\n",
+			zct->full_evals, zct->lazy_evals,
+			(float)zct->full_evals / (zct->nodes + zct->q_nodes),
+			zct->bitbase_hits);
 #ifdef SMP
 		print("smp:    splits=%i stops=%i/%.1f%%\n",
 			smp_data->splits_done, smp_data->stops_done,
@@ -278,6 +406,8 @@ void print_search_info(void)
 		if (zct->engine_state != BENCHMARKING)
 			print_statistics();
 #endif
+		if (zct->engine_state != BENCHMARKING)
+			print_profile();
 	}
 	/* ICS output */
 	else if (zct->ics_mode && zct->engine_state != PONDERING)
@@ -305,11 +435,138 @@ void print_search_info(void)
 	}
 }
 
+/**
+print_research_counts():
+Print out the number of aspiration window re-searches at the root for each
+iteration that had any, as fail highs/fail lows.
+Created 101926; last modified 101926
+**/
+void print_research_counts(void)
+{
+	int x;
+	int fail_highs;
+	int fail_lows;
+
+	fail_highs = fail_lows = 0;
+	for (x = 1; x <= zct->current_iteration && x < MAX_PLY; x++)
+	{
+		fail_highs += zct->fail_highs_by_depth[x];
+		fail_lows += zct->fail_lows_by_depth[x];
+	}
+	print("root:   fail highs=%i fail lows=%i", fail_highs, fail_lows);
+	if (fail_highs + fail_lows > 0)
+	{
+		print(" by depth=(");
+		for (x = 1; x <= zct->current_iteration && x < MAX_PLY; x++)
+		{
+			if (zct->fail_highs_by_depth[x] + zct->fail_lows_by_depth[x] == 0)
+				continue;
+			print(" %i:%i/%i", x, zct->fail_highs_by_depth[x],
+				zct->fail_lows_by_depth[x]);
+		}
+		print(" )");
+	}
+	print("\n");
+}
+
+/**
+print_tree_stats():
+Prints the shape of the tree searched in the iteration that just finished, as
+one line of name=value pairs, so that it can be compared between versions.
+The effective branching factor is the ratio of the nodes searched in this
+iteration to those searched in the last one.
+Created 101926; last modified 101926
+**/
+void print_tree_stats(void)
+{
+	BITBOARD nodes;
+	SEARCH_COUNTERS c;
+
+	nodes = zct->nodes + zct->q_nodes - zct->iteration_nodes;
+	c = zct->counters;
+	subtract_counters(&c, &zct->iteration_counters);
+
+	if (zct->tree_stats)
+	{
+		if (zct->protocol == UCI)
+			print("info string ");
+		print("tree: depth=%i nodes=%L ebf=%.2f fh=%L fh_first=%.1f pv=%L "
+			"pv_first=%.1f fl=%L hash_probes=%L hash_cut=%.1f check_ext=%L "
+			"one_rep_ext=%L threat_ext=%L passed_pawn_ext=%L\n",
+			zct->current_iteration, nodes, zct->last_iteration_nodes ?
+			(float)nodes / zct->last_iteration_nodes : 0.0, c.fail_high_nodes,
+			(float)100.0 * c.fail_high_first / MAX(1, c.fail_high_nodes),
+			c.pv_nodes, (float)100.0 * c.pv_first / MAX(1, c.pv_nodes),
+			c.fail_low_nodes, c.hash_probes,
+			(float)100.0 * c.hash_cutoffs / MAX(1, c.hash_probes),
+			c.check_extensions_done, c.one_rep_extensions_done,
+			c.threat_extensions_done, c.passed_pawn_extensions_done);
+	}
+
+	zct->last_iteration_nodes = nodes;
+	zct->iteration_nodes = zct->nodes + zct->q_nodes;
+	zct->iteration_counters = zct->counters;
+}
+
+/**
+add_counters():
+Adds the search counters in from into to.
+Created 101926; last modified 101926
+**/
+void add_counters(SEARCH_COUNTERS *to, SEARCH_COUNTERS *from)
+{
+	to->pv_nodes += from->pv_nodes;
+	to->fail_high_nodes += from->fail_high_nodes;
+	to->fail_low_nodes += from->fail_low_nodes;
+	to->pv_first += from->pv_first;
+	to->fail_high_first += from->fail_high_first;
+	to->hash_probes += from->hash_probes;
+	to->hash_hits += from->hash_hits;
+	to->hash_cutoffs += from->hash_cutoffs;
+	to->check_extensions_done += from->check_extensions_done;
+	to->one_rep_extensions_done += from->one_rep_extensions_done;
+	to->threat_extensions_done += from->threat_extensions_done;
+	to->passed_pawn_extensions_done += from->passed_pawn_extensions_done;
+	to->singular_extensions_done += from->singular_extensions_done;
+}
+
+/**
+subtract_counters():
+Subtracts the search counters in from from to.
+Created 101926; last modified 101926
+**/
+void subtract_counters(SEARCH_COUNTERS *to, SEARCH_COUNTERS *from)
+{
+	to->pv_nodes -= from->pv_nodes;
+	to->fail_high_nodes -= from->fail_high_nodes;
+	to->fail_low_nodes -= from->fail_low_nodes;
+	to->pv_first -= from->pv_first;
+	to->fail_high_first -= from->fail_high_first;
+	to->hash_probes -= from->hash_probes;
+	to->hash_hits -= from->hash_hits;
+	to->hash_cutoffs -= from->hash_cutoffs;
+	to->check_extensions_done -= from->check_extensions_done;
+	to->one_rep_extensions_done -= from->one_rep_extensions_done;
+	to->threat_extensions_done -= from->threat_extensions_done;
+	to->passed_pawn_extensions_done -= from->passed_pawn_extensions_done;
+	to->singular_extensions_done -= from->singular_extensions_done;
+}
+
+/**
+clear_counters():
+Sets all of the search counters to zero.
+Created 101926; last modified 101926
+**/
+void clear_counters(SEARCH_COUNTERS *counters)
+{
+	memset(counters, 0, sizeof(SEARCH_COUNTERS));
+}
+
 /**
 sum_counters():
 If we are using multiple processors, then add the counters from each processor
 into the global stats.
-Created 083006; last modified 031709
+Created 083006; last modified 101926
 **/
 void sum_counters(void)
 {
@@ -317,11 +574,13 @@ void sum_counters(void)
 	int x;
 
 	zct->nodes = zct->q_nodes = 0;
+	clear_counters(&zct->counters);
 	idle_time = 0;
 	for (x = 0; x < zct->process_count; x++)
 	{
 		zct->nodes += smp_block[x].nodes;
 		zct->q_nodes += smp_block[x].q_nodes;
+		add_counters(&zct->counters, &smp_block[x].counters);
 		idle_time += smp_block[x].idle_time;
 		if (smp_block[x].last_idle_time)
 			idle_time += get_time() - smp_block[x].last_idle_time;
@@ -332,7 +591,7 @@ void sum_counters(void)
 /**
 initialize_counters():
 Initialize all of the simple counters used during the search.
-Created 092906; last modified 031709
+Created 092906; last modified 101926
 **/
 void initialize_counters(void)
 {
@@ -345,6 +604,7 @@ void initialize_counters(void)
 	{
 		smp_block[x].nodes = 0;
 		smp_block[x].q_nodes = 0;
+		clear_counters(&smp_block[x].counters);
 		smp_block[x].idle_time = 0;
 		if (x != 0)
 			smp_block[x].last_idle_time = get_time();
@@ -356,29 +616,25 @@ void initialize_counters(void)
 	zct->q_nodes = 0;
 	zct->max_depth_reached = 0;
 	zct->nodes_until_check = zct->nodes_per_check;
-	zct->pv_nodes = 0;
-	zct->fail_high_nodes = 0;
-	zct->fail_low_nodes = 0;
-	zct->pv_first = 0;
-	zct->fail_high_first = 0;
-	zct->hash_probes = 0;
-	zct->hash_hits = 0;
-	zct->hash_cutoffs = 0;
+	clear_counters(&zct->counters);
+	clear_counters(&zct->iteration_counters);
+	zct->iteration_nodes = 0;
+	zct->last_iteration_nodes = 0;
 	zct->pawn_hash_probes = 0;
 	zct->pawn_hash_hits = 0;
 	zct->eval_hash_probes = 0;
 	zct->eval_hash_hits = 0;
+	zct->full_evals = 0;
+	zct->lazy_evals = 0;
 	zct->qsearch_hash_probes = 0;
 	zct->qsearch_hash_hits = 0;
-	zct->check_extensions_done = 0;
-	zct->one_rep_extensions_done = 0;
-	zct->threat_extensions_done = 0;
-	zct->singular_extensions_done = 0;
-	zct->passed_pawn_extensions_done = 0;
+	zct->bitbase_hits = 0;
 	
 	for (x = 0; x < MAX_PLY; x++)
 	{
 		zct->best_score_by_depth[x] = -MATE;
 		zct->pv_changes_by_depth[x] = 0;
+		zct->fail_highs_by_depth[x] = 0;
+		zct->fail_lows_by_depth[x] = 0;
 	}
 }
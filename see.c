@@ -21,12 +21,13 @@
 #include "functions.h"
 #include "globals.h"
 #include "eval.h"
+#include "profile.h"
 
 /**
 see():
 Performs a static exchange evaluation (SEE) for the given capture to see if it
 is winning or not.
-Created 091706; last modified 090708
+Created 091706; last modified 101926
 **/
 VALUE see(SQUARE to, SQUARE from)
 {
@@ -40,13 +41,18 @@ VALUE see(SQUARE to, SQUARE from)
 	PIECE piece;
 	VALUE value[32];
 	VALUE attacked_piece;
+	PROFILE_DECLARE(profile_start)
 
+	PROFILE_START(profile_start);
 	count = 0;
 	value[0] = piece_value[board.piece[to]];
 	/* If we are promoting a pawn, we need to change the value of the piece. */
 	if (board.piece[from] == PAWN &&
 		(RANK_OF(to) == RANK_1 || RANK_OF(to) == RANK_8))
-		value[0] += attacked_piece = piece_value[QUEEN] - piece_value[PAWN];
+	{
+		value[0] += piece_value[QUEEN] - piece_value[PAWN];
+		attacked_piece = piece_value[QUEEN];
+	}
 	else
 		attacked_piece = piece_value[board.piece[from]];
 	/* Initialize the occupied set by clearing the piece that just moved.  */
@@ -127,5 +133,146 @@ VALUE see(SQUARE to, SQUARE from)
 			value[count - 1] = -value[count];
 		count--;
 	}
-	return value[0];	
+	PROFILE_RETURN(PROFILE_SEE, profile_start, value[0]);
+}
+
+/**
+see_cached():
+Performs a static exchange evaluation using the attack maps stored in the
+given eval block. If the opponent attacks neither the destination square nor
+the square the piece moves from (which would be needed for an x-ray through
+it), the exchange is just the captured piece, so we don't need to run the
+full SEE.
+Created 101926; last modified 101926
+**/
+VALUE see_cached(EVAL_BLOCK *eval_block, SQUARE to, SQUARE from)
+{
+	VALUE value;
+
+	if (eval_block->attacks[board.side_ntm] == 0 ||
+		(eval_block->attacks[board.side_ntm] & (MASK(to) | MASK(from))))
+		return see(to, from);
+
+	value = piece_value[board.piece[to]];
+	if (board.piece[from] == PAWN &&
+		(RANK_OF(to) == RANK_1 || RANK_OF(to) == RANK_8))
+		value += piece_value[QUEEN] - piece_value[PAWN];
+	return value;
+}
+
+/**
+see_ge():
+Tests if the static exchange evaluation of the given capture is at least the
+given threshold. This is the same exchange as see(), but instead of building
+the whole capture sequence and minimaxing it, we keep track of the balance
+relative to the threshold and stop as soon as one side can't change the
+outcome anymore.
+Created 101926; last modified 101926
+**/
+BOOL see_ge(SQUARE to, SQUARE from, VALUE threshold)
+{
+	BOOL result;
+	BITBOARD attackers;
+	BITBOARD side_attackers;
+	BITBOARD occupied;
+	BITBOARD piece_bb;
+	COLOR color;
+	PIECE piece;
+	VALUE swap;
+	PROFILE_DECLARE(profile_start)
+
+	PROFILE_START(profile_start);
+	/* The gain of the first capture, including a promotion. */
+	piece = board.piece[from];
+	swap = piece_value[board.piece[to]] - threshold;
+	if (piece == PAWN && (RANK_OF(to) == RANK_1 || RANK_OF(to) == RANK_8))
+	{
+		swap += piece_value[QUEEN] - piece_value[PAWN];
+		piece = QUEEN;
+	}
+	if (swap < 0)
+		PROFILE_RETURN(PROFILE_SEE_GE, profile_start, FALSE);
+	/* If we're still above the threshold after losing the piece, we don't
+		need to look any further. */
+	swap = piece_value[piece] - swap;
+	if (swap <= 0)
+		PROFILE_RETURN(PROFILE_SEE_GE, profile_start, TRUE);
+
+	occupied = board.occupied_bb ^ MASK(from);
+	attackers = (pawn_caps_bb[BLACK][to] & board.piece_bb[PAWN] &
+			board.color_bb[WHITE]) |
+		(pawn_caps_bb[WHITE][to] & board.piece_bb[PAWN] &
+			board.color_bb[BLACK]) |
+		(knight_moves_bb[to] & board.piece_bb[KNIGHT]) |
+		(king_moves_bb[to] & board.piece_bb[KING]) |
+		(BISHOP_ATTACKS(to, occupied) &
+			(board.piece_bb[BISHOP] | board.piece_bb[QUEEN])) |
+		(ROOK_ATTACKS(to, occupied) &
+			(board.piece_bb[ROOK] | board.piece_bb[QUEEN]));
+
+	/* Now go through the captures, taking the lowest-valued attacker for each
+		side. The swap value is how much the side to capture has to win back
+		for the result to flip; once that's not possible, we're done. */
+	color = board.side_tm;
+	result = TRUE;
+	while (TRUE)
+	{
+		color = COLOR_FLIP(color);
+		attackers &= occupied;
+		side_attackers = attackers & board.color_bb[color];
+		if (!side_attackers)
+			break;
+		result = !result;
+
+		for (piece = PAWN; piece < KING; piece++)
+		{
+			piece_bb = side_attackers & board.piece_bb[piece];
+			if (piece_bb)
+				break;
+		}
+		/* The king can only capture if the other side has no attackers
+			left, or else the capture would be illegal. */
+		if (piece == KING)
+			PROFILE_RETURN(PROFILE_SEE_GE, profile_start,
+				(attackers & board.color_bb[COLOR_FLIP(color)]) ?
+				!result : result);
+
+		swap = piece_value[piece] - swap;
+		if (swap < result)
+			break;
+
+		/* Take the attacker off the board, and add in any sliders behind
+			it. */
+		occupied ^= piece_bb & -piece_bb;
+		if (piece == PAWN || piece == BISHOP || piece == QUEEN)
+			attackers |= BISHOP_ATTACKS(to, occupied) &
+				(board.piece_bb[BISHOP] | board.piece_bb[QUEEN]);
+		if (piece == ROOK || piece == QUEEN)
+			attackers |= ROOK_ATTACKS(to, occupied) &
+				(board.piece_bb[ROOK] | board.piece_bb[QUEEN]);
+	}
+	PROFILE_RETURN(PROFILE_SEE_GE, profile_start, result);
+}
+
+/**
+see_ge_cached():
+Tests if the static exchange evaluation of the given capture is at least the
+given threshold, skipping the exchange when the eval block's attack maps show
+that the opponent can't recapture, like see_cached().
+Created 101926; last modified 101926
+**/
+BOOL see_ge_cached(EVAL_BLOCK *eval_block, SQUARE to, SQUARE from,
+	VALUE threshold)
+{
+	VALUE value;
+
+	if (eval_block->attacks[board.side_ntm] == 0 ||
+		(eval_block->attacks[board.side_ntm] & (MASK(to) | MASK(from))))
+		return see_ge(to, from, threshold);
+
+	value = piece_value[board.piece[to]];
+	if (board.piece[from] == PAWN &&
+		(RANK_OF(to) == RANK_1 || RANK_OF(to) == RANK_8))
+		value += piece_value[QUEEN] - piece_value[PAWN];
+	return value >= threshold;
 }
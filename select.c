@@ -22,6 +22,7 @@
 #include "globals.h"
 #include "eval.h"
 #include "smp.h"
+#include "profile.h"
 
 #define SCORE_HASH_MOVE		(6001)
 #define SCORE_THREAT_MOVE	(6000)
@@ -32,13 +33,18 @@
 #define SCORE_LOSE_CAP		(4000)
 #define SCORE_EVEN_MAT		(2000)
 #define SCORE_PPAWN			(500)
+#define SCORE_CHECK			(128)
 
 #define SCORE_PCSQ_SCALE	(64)
 
+/* The number of moves picked one at a time from a move list before the rest of
+	it is sorted. */
+#define SORT_LAZY_PICKS		(3)
+
 /**
 score_move():
 Scores a move based on standard move-ordering terms. Returns the result of the static exchange evaluator.
-Created 101307; last modified 081608
+Created 101307; last modified 101926
 **/
 VALUE score_move(SEARCH_BLOCK *sb, MOVE *move)
 {
@@ -56,13 +62,13 @@ VALUE score_move(SEARCH_BLOCK *sb, MOVE *move)
 	/* Check if the move is a killer or a counter move. */
 	for (x = 0; x < 2 && score == 0; x++)
 	{
-		if (sb->ply > 0 && *move == zct->counter_move[board.side_tm]
+		if (sb->ply > 0 && *move == heuristics->counter_move[board.side_tm]
 			[MOVE_KEY((sb - 1)->move)][x])
 			score = SCORE_COUNTER - x;
 	}
 	for (x = 0; x < 2 && score == 0; x++)
 	{
-		if (*move == zct->killer_move[sb->ply][x])
+		if (*move == heuristics->killer_move[sb->ply][x])
 			score = SCORE_KILLER - x;
 	}
 	/* If the move wasn't a killer or counter move, give a regular score. */
@@ -71,7 +77,7 @@ VALUE score_move(SEARCH_BLOCK *sb, MOVE *move)
 		from = MOVE_FROM(*move);
 		to = MOVE_TO(*move);
 		/* captures */
-		see_score = see(to, from);
+		see_score = see_cached(&sb->eval_block, to, from);
 		/* Check for illegal move. */
 		if (see_score == -MATE)
 			return see_score;
@@ -128,7 +134,7 @@ VALUE score_move(SEARCH_BLOCK *sb, MOVE *move)
 /**
 score_moves():
 Generates and sets the score for each move on the stack.
-Created 082606; last modified 011108
+Created 082606; last modified 101926
 **/
 void score_moves(SEARCH_BLOCK *sb)
 {
@@ -154,10 +160,179 @@ void score_moves(SEARCH_BLOCK *sb)
 	sb->next_move = sb->first_move;
 }
 
+/**
+score_captures():
+Generates and scores the legal captures and promotions for the staged move
+selection. Losing captures and underpromotions are moved to the end of the
+list, so that they can be tried after the quiet moves.
+Created 101926; last modified 101926
+**/
+void score_captures(SEARCH_BLOCK *sb)
+{
+	MOVE *move;
+	MOVE temp;
+	VALUE score;
+
+	sb->last_move = generate_legal(sb->first_move, GEN_CAPTURES);
+	for (move = sb->first_move; move < sb->last_move; move++)
+	{
+		score = score_move(sb, move);
+		if (score == -MATE)
+			*move-- = *--sb->last_move;
+	}
+	/* Split the captures into the good and the bad ones. */
+	sb->next_bad_cap = sb->last_move;
+	sb->last_bad_cap = sb->last_move;
+	for (move = sb->first_move; move < sb->next_bad_cap; move++)
+	{
+		if ((board.color[MOVE_TO(*move)] != EMPTY &&
+			MOVE_SCORE(*move) < SCORE_EVEN_CAP) ||
+			(MOVE_PROMOTE(*move) && MOVE_PROMOTE(*move) != QUEEN))
+		{
+			temp = *move;
+			*move-- = *--sb->next_bad_cap;
+			*sb->next_bad_cap = temp;
+		}
+	}
+	sb->next_move = sb->first_move;
+}
+
+/**
+score_quiets():
+Generates and scores the legal quiet moves for the staged move selection. They
+are put after the captures, and moves that were already tried are left out.
+Safe checking moves get a bonus, so that they are tried before the other quiet
+moves.
+Created 101926; last modified 101926
+**/
+void score_quiets(SEARCH_BLOCK *sb)
+{
+	MOVE *move;
+	VALUE score;
+	CHECK_INFO check_info;
+
+	get_check_info(&check_info);
+	sb->next_move = sb->last_move;
+	sb->last_move = generate_legal(sb->next_move, GEN_QUIETS);
+	for (move = sb->next_move; move < sb->last_move; move++)
+	{
+		if (move_is_tried(sb, *move))
+		{
+			*move-- = *--sb->last_move;
+			continue;
+		}
+		score = score_move(sb, move);
+		if (score == -MATE)
+			*move-- = *--sb->last_move;
+		else if (score >= 0 && move_gives_check(*move, &check_info))
+			*move += SET_SCORE(SCORE_CHECK);
+	}
+}
+
+/**
+move_is_tried():
+Checks if the move has already been returned by one of the single move stages
+of the move selection (hash move, threat move, counter and killer moves).
+Created 101926; last modified 101926
+**/
+BOOL move_is_tried(SEARCH_BLOCK *sb, MOVE move)
+{
+	int x;
+
+	move = MOVE_COMPARE(move);
+	if (move == MOVE_COMPARE(sb->hash_move) ||
+		move == MOVE_COMPARE(board.threat_move[sb->ply]))
+		return TRUE;
+	for (x = 0; x < 4; x++)
+		if (move == sb->killer[x])
+			return TRUE;
+	return FALSE;
+}
+
+/**
+killer_is_valid():
+Checks if a counter or killer move can be tried in the current position. It
+must be a legal quiet move that hasn't been tried yet. Captures and promotions
+are left out, since they are generated with the captures anyway.
+Created 101926; last modified 101926
+**/
+BOOL killer_is_valid(SEARCH_BLOCK *sb, MOVE move)
+{
+	SQUARE from;
+	SQUARE to;
+
+	if (move == NO_MOVE || move_is_tried(sb, move))
+		return FALSE;
+	from = MOVE_FROM(move);
+	to = MOVE_TO(move);
+	if (board.color[to] != EMPTY || MOVE_PROMOTE(move) ||
+		(board.piece[from] == PAWN && FILE_OF(from) != FILE_OF(to)))
+		return FALSE;
+	return move_is_valid(move) && move_is_legal(sb, move);
+}
+
+/**
+select_best():
+Selects the highest scored of the remaining moves in a move list, which starts
+at first_move, and returns it. The move is put at next_move, and the moves in
+between are shifted down, so that moves with equal scores stay in generation
+order. Most cut nodes fail high on one of the first few moves, so these are
+picked one at a time instead of sorting the whole list. After SORT_LAZY_PICKS
+moves the node will probably search all of them, so the rest of the list is
+sorted at once, and the moves are taken in order from then on.
+Created 101926; last modified 101926
+**/
+MOVE select_best(MOVE *first_move, MOVE *next_move, MOVE *last_move)
+{
+	MOVE *m;
+	MOVE *best_move;
+	MOVE move;
+
+	if (next_move - first_move == SORT_LAZY_PICKS)
+		sort_moves(next_move, last_move);
+	else if (next_move - first_move < SORT_LAZY_PICKS)
+	{
+		best_move = next_move;
+		for (m = next_move + 1; m < last_move; m++)
+		{
+			if (MOVE_SCORE(*m) > MOVE_SCORE(*best_move))
+				best_move = m;
+		}
+		move = *best_move;
+		for (m = best_move; m > next_move; m--)
+			*m = *(m - 1);
+		*next_move = move;
+	}
+	return *next_move;
+}
+
+/**
+sort_moves():
+Sorts the moves in the given part of the move list by score, highest first.
+This is an insertion sort, which is the fastest for the short lists we have,
+and it keeps moves with equal scores in generation order.
+Created 101926; last modified 101926
+**/
+void sort_moves(MOVE *first_move, MOVE *last_move)
+{
+	MOVE *m;
+	MOVE *n;
+	MOVE move;
+
+	for (m = first_move + 1; m < last_move; m++)
+	{
+		move = *m;
+		for (n = m; n > first_move && MOVE_SCORE(*(n - 1)) < MOVE_SCORE(move);
+			n--)
+			*n = *(n - 1);
+		*n = move;
+	}
+}
+
 /**
 score_caps():
 Generates and sets the score for each move on the stack, also throwing away captures deemed losing by SEE.
-Created 082606; last modified 072108
+Created 082606; last modified 101926
 **/
 void score_caps(SEARCH_BLOCK *sb)
 {
@@ -178,14 +353,14 @@ void score_caps(SEARCH_BLOCK *sb)
 /**
 score_checks():
 Generates and sets the score for each check on the stack.
-Created 110606; last modified 110607
+Created 110606; last modified 101926
 **/
 void score_checks(SEARCH_BLOCK *sb)
 {
 	VALUE score;
 	MOVE *move;
 
-	sb->last_move = generate_checks(sb->first_move);
+	sb->last_move = generate_checks(sb->first_move, &sb->eval_block);
 	for (move = sb->first_move; move < sb->last_move; move++)
 	{
 		score = board.piece[MOVE_TO(*move)] * 8 -
@@ -197,15 +372,17 @@ void score_checks(SEARCH_BLOCK *sb)
 
 /**
 select_move():
-Selects the highest scored move from the move list.
-Created 081505; last modified 122008
+Selects the next move to search. Outside of check, moves are generated in
+stages: the hash and threat moves, good captures, counter and killer moves,
+quiet moves, and finally bad captures. Quiet moves are only generated when
+all of the earlier stages failed to produce a cutoff.
+Created 081505; last modified 101926
 **/
 MOVE select_move(SEARCH_BLOCK *sb)
 {
-	int best_score;
-	MOVE *m;
-	MOVE *best_move;
+	int x;
 	MOVE move;
+	PROFILE_DECLARE(profile_start)
 
 #ifdef SMP
 	SPLIT_POINT *sp;
@@ -222,6 +399,7 @@ MOVE select_move(SEARCH_BLOCK *sb)
 	}
 #endif
 
+	PROFILE_START(profile_start);
 	move = NO_MOVE;
 	/* Select a move according to the move state. Some of these case statements
 		are fall-through, because if a move is valid it will be returned, and
@@ -232,49 +410,105 @@ MOVE select_move(SEARCH_BLOCK *sb)
 			sb->select_state = SELECT_THREAT_MOVE;
 			move = sb->hash_move;
 			move |= SET_SCORE(SCORE_HASH_MOVE);
-			if (move_is_valid(move))
+			if (move_is_valid(move) && move_is_legal(sb, move))
 				goto done;
 
 		case SELECT_THREAT_MOVE:
 			sb->select_state = SELECT_GEN_MOVES;
 			move = board.threat_move[sb->ply];
 			move |= SET_SCORE(SCORE_THREAT_MOVE);
-			if (move_is_valid(move))
+			if (MOVE_COMPARE(move) != MOVE_COMPARE(sb->hash_move) &&
+				move_is_valid(move) && move_is_legal(sb, move))
 				goto done;
 
 		case SELECT_GEN_MOVES:
-			sb->select_state = SELECT_MOVE;
-			score_moves(sb);
+			/* When in check, generate all of the evasions at once, as the
+				search needs to know how many there are. */
+			if (sb->check)
+			{
+				sb->select_state = SELECT_MOVE;
+				score_moves(sb);
+				goto select_move;
+			}
+			sb->select_state = SELECT_GOOD_CAPS;
+			for (x = 0; x < 4; x++)
+				sb->killer[x] = NO_MOVE;
+			score_captures(sb);
 
-		case SELECT_MOVE:
-select_move:
-			if (sb->next_move >= sb->last_move)
+		case SELECT_GOOD_CAPS:
+			while (sb->next_move < sb->next_bad_cap)
 			{
-				move = NO_MOVE;
-				goto done;
+				move = select_best(sb->first_move, sb->next_move++,
+					sb->next_bad_cap);
+				if (!move_is_tried(sb, move))
+					goto done;
 			}
+			sb->select_state = SELECT_COUNTER_1;
 
-			best_score = MOVE_SCORE(*sb->next_move);
-			best_move = sb->next_move;
-			for (m = sb->next_move + 1; m < sb->last_move; m++)
+		case SELECT_COUNTER_1:
+		case SELECT_COUNTER_2:
+		case SELECT_KILLER_1:
+		case SELECT_KILLER_2:
+			while (sb->select_state <= SELECT_KILLER_2)
 			{
-				if (MOVE_SCORE(*m) > best_score)
+				x = sb->select_state - SELECT_COUNTER_1;
+				sb->select_state++;
+				if (x < 2)
+					move = (sb->ply > 0 ?
+						heuristics->counter_move[board.side_tm]
+						[MOVE_KEY((sb - 1)->move)][x] : NO_MOVE);
+				else
+					move = heuristics->killer_move[sb->ply][x - 2];
+				if (killer_is_valid(sb, move))
 				{
-					best_score = MOVE_SCORE(*m);
-					best_move = m;
+					sb->killer[x] = move;
+					score_move(sb, &move);
+					goto done;
 				}
 			}
-			/* Swap the best move with the current move. We do this even in the
-				case that they are the same, but it doesn't matter. */
-			move = *best_move;
-			*best_move = *sb->next_move;
-			*sb->next_move = move;
 
-			sb->next_move++;
+		case SELECT_GEN_QUIETS:
+			sb->select_state = SELECT_QUIETS;
+			score_quiets(sb);
+
+		case SELECT_QUIETS:
+			if (sb->next_move < sb->last_move)
+			{
+				move = select_best(sb->last_bad_cap, sb->next_move++,
+					sb->last_move);
+				goto done;
+			}
+			sb->select_state = SELECT_BAD_CAPS;
+
+		case SELECT_BAD_CAPS:
+			/* There are usually only a few bad captures, so they are
+				always picked one at a time. */
+			while (sb->next_bad_cap < sb->last_bad_cap)
+			{
+				move = select_best(sb->next_bad_cap, sb->next_bad_cap,
+					sb->last_bad_cap);
+				sb->next_bad_cap++;
+				if (!move_is_tried(sb, move))
+					goto done;
+			}
+			move = NO_MOVE;
+			break;
+
+		case SELECT_MOVE:
+select_move:
+			if (sb->next_move >= sb->last_move)
+			{
+				move = NO_MOVE;
+				goto done;
+			}
+
+			move = select_best(sb->first_move, sb->next_move++,
+				sb->last_move);
 			/* Check if the move is the hash move or the threat move, and skip
 				it if it is. We do this after incrementing next_move, so we
 				make sure to skip it. */
-			if (move == sb->hash_move || move == board.threat_move[sb->ply])
+			if (MOVE_COMPARE(move) == MOVE_COMPARE(sb->hash_move) ||
+				MOVE_COMPARE(move) == MOVE_COMPARE(board.threat_move[sb->ply]))
 				goto select_move;
 
 			break;
@@ -294,23 +528,22 @@ done:
 			(*board.split_point)->id, move, MOVE_SCORE(move)));
 	}
 #endif
-	return move;
+	PROFILE_RETURN(PROFILE_SELECT_MOVE, profile_start, move);
 }
 
 /**
 select_qsearch_move():
 Selects the highest scored move from the move list.
-Created 122008; last modified 122008
+Created 122008; last modified 101926
 **/
 MOVE select_qsearch_move(SEARCH_BLOCK *sb)
 {
 	VALUE eval;
-	MOVE *m;
-	MOVE *best_move;
+	VALUE threshold;
 	MOVE move;
-	int score;
-	int best_score;
+	PROFILE_DECLARE(profile_start)
 
+	PROFILE_START(profile_start);
 	/* Select a move according to the move state. Some of these case statements
 		are fall-through, because if a move is valid it will be returned, and
 		otherwise the next state is used to find one. */
@@ -321,14 +554,16 @@ MOVE select_qsearch_move(SEARCH_BLOCK *sb)
 			move = sb->hash_move;
 			move |= SET_SCORE(SCORE_HASH_MOVE);
 			if (move_is_valid(move))
-				return move;
+				PROFILE_RETURN(PROFILE_SELECT_QSEARCH_MOVE, profile_start,
+					move);
 
 		case SELECT_THREAT_MOVE:
 			sb->select_state = SELECT_GEN_MOVES;
 			move = board.threat_move[sb->ply];
 			move |= SET_SCORE(SCORE_THREAT_MOVE);
 			if (move_is_valid(move))
-				return move;
+				PROFILE_RETURN(PROFILE_SELECT_QSEARCH_MOVE, profile_start,
+					move);
 
 		case SELECT_GEN_MOVES:
 			sb->select_state = SELECT_MOVE;
@@ -350,24 +585,10 @@ MOVE select_qsearch_move(SEARCH_BLOCK *sb)
 		case SELECT_MOVE:
 select_move:
 			if (sb->next_move >= sb->last_move)
-				return NO_MOVE;
-			best_score = MOVE_SCORE(*sb->next_move);
-			best_move = sb->next_move;
-			for (m = sb->next_move + 1; m < sb->last_move; m++)
-			{
-				if (MOVE_SCORE(*m) > best_score)
-				{
-					best_score = MOVE_SCORE(*m);
-					best_move = m;
-				}
-			}
-			/* Swap the best move with the current move. We do this even in the
-				case that they are the same, but it doesn't matter. */
-			move = *best_move;
-			*best_move = *sb->next_move;
-			*sb->next_move = move;
-
-			sb->next_move++;
+				PROFILE_RETURN(PROFILE_SELECT_QSEARCH_MOVE, profile_start,
+					NO_MOVE);
+			move = select_best(sb->first_move, sb->next_move++,
+				sb->last_move);
 			/* Check if the move is the hash move or the threat move, and skip
 				it if it is. We do this after incrementing next_move, so we
 				make sure to skip it. */
@@ -375,33 +596,33 @@ select_move:
 				goto select_move;
 
 			/* Delta pruning. We prune a capture if it is losing (SEE < 0) or
-				if the material gain cannot bring the score up to alpha. */
-	//		if (!sb->check && !sb->threat)
+				if the material gain cannot bring the score up to alpha. We
+				only need to know if the SEE reaches the threshold, which is
+				cheaper than calculating it. */
+			threshold = 0;
+			if (!sb->check && !sb->threat)
 			{
-				score = see(MOVE_TO(move), MOVE_FROM(move));
-				if (score < 0)
-					goto select_move;
-
 				eval = sb->eval_block.full_eval;
-			if (!sb->check && !sb->threat)
-				if (score + 50 + eval < sb->alpha)
-					goto select_move;
+				threshold = MAX(threshold, sb->alpha - eval - 50);
 			}
+			if (!see_ge_cached(&sb->eval_block, MOVE_TO(move),
+				MOVE_FROM(move), threshold))
+				goto select_move;
 
-			return move;
+			PROFILE_RETURN(PROFILE_SELECT_QSEARCH_MOVE, profile_start, move);
 
 		default:
 			/* Compiler shut-up code */
 			break;
 	}
 
-	return NO_MOVE;
+	PROFILE_RETURN(PROFILE_SELECT_QSEARCH_MOVE, profile_start, NO_MOVE);
 }
 
 /**
 select_root_move():
 Selects the highest scored move from the move list.
-Created 082606; last modified 110606
+Created 082606; last modified 101926
 **/
 ROOT_MOVE *select_root_move(void)
 {
@@ -415,10 +636,12 @@ ROOT_MOVE *select_root_move(void)
 	for (move = best_move + 1;
 		move < zct->root_move_list + zct->root_move_count; move++)
 	{
-		/* Order the best move first, and order all other moves after it
-			according to the node count of its subtree last iteration. */
+		/* Order the best move first (or the best lines in MultiPV mode, which
+			get the last root_pv_counter values), and order all other moves
+			after it according to the node count of its subtree last
+			iteration. */
 		if (move->score > best_move->score || (move->nodes > best_move->nodes &&
-			best_move->score != zct->root_pv_counter))
+			best_move->score <= zct->root_pv_counter - zct->multi_pv))
 			best_move = move;
 	}
 	if (best_move != zct->next_root_move)
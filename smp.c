@@ -21,6 +21,7 @@
 #include "functions.h"
 #include "globals.h"
 #include "smp.h"
+#include "trace.h"
 
 #ifdef SMP
 
@@ -37,13 +38,14 @@ void smp_child_sig(int x);
 /**
 initialize_smp():
 Initializes the smp functionality for the given number of processes.
-Created 081305; last modified 103008
+Created 081305; last modified 101926
 **/
 void initialize_smp(int procs)
 {
 	int x;
 	int y;
 	int z;
+	HEURISTIC_TABLE *table;
 
 	/* Set up the default signals. This is because the child processes
 		inherit all of the parent's signal handlers, and we don't want that. */
@@ -85,6 +87,7 @@ void initialize_smp(int procs)
 	/* Initialize the data. */
 	/* SMP data */
 	smp_data->return_flag = FALSE;
+	smp_data->root_split.active = FALSE;
 	/* smp blocks */
 	for (x = 0; x < procs; x++)
 	{
@@ -103,6 +106,7 @@ void initialize_smp(int procs)
 			that every time we split, we just start at board.id and increment
 			by MAX_CPUS. */
 		smp_block[x].split_id = x;
+		smp_block[x].root_move = -1;
 
 #ifdef ZCT_WINDOWS
 		_pipe(smp_block[x].wait_pipe, 8, O_BINARY);
@@ -134,6 +138,9 @@ void initialize_smp(int procs)
 	/* Initialize the spin locks. */
 	LOCK_INIT(smp_data->io_lock);
 	LOCK_INIT(smp_data->lock);
+	LOCK_INIT(smp_data->batch_lock);
+	LOCK_INIT(smp_data->bitbase_lock);
+	LOCK_INIT(smp_data->root_split.lock);
 	for (x = 0; x < procs; x++)
 	{
 		LOCK_INIT(smp_block[x].lock);
@@ -145,13 +152,28 @@ void initialize_smp(int procs)
 		LOCK_INIT(split_point[x].move_lock);
 	}
 
-	/* Now start the child processes. */
+	/* Now start the child processes. The master's trace is written out
+		first, so that the children don't inherit any buffered records. */
+	trace_flush();
 	for (x = 1; x < zct->process_count; x++)
 	{
 		/* Child process. */
 		if ((y = fork()) == 0)
 		{
 			board.id = x;
+			/* Drop the master's trace file. We open our own if needed. */
+			trace_close();
+			/* Unless the move ordering tables are shared, the child gets its
+				own copy of them, starting with what the master has learned. */
+			if (!zct->shared_heuristics)
+			{
+				if ((table = (HEURISTIC_TABLE *)malloc(sizeof(HEURISTIC_TABLE)))
+					== NULL)
+					fatal_error("fatal error: could not allocate move ordering "
+						"tables");
+				*table = *heuristics;
+				heuristics = table;
+			}
 			idle_loop(x);
 		}
 		/* Parent process. */
@@ -233,7 +255,7 @@ DWORD WINAPI thread_init(LPVOID arg)
 /**
 idle_loop():
 Loop the child processes while waiting for work.
-Created 081405; last modified 122208
+Created 081405; last modified 101926
 **/
 void idle_loop(int id)
 {
@@ -257,6 +279,7 @@ void idle_loop(int id)
 				smp_block[id].input = 0;
 				smp_block[id].output = SMP_DONE;
 				root_entry = board.game_entry;
+				smp_block[id].root_move = -1;
 				set_idle();
 				board.search_stack[0].search_state = SEARCH_CHILD_RETURN;
 				board.search_stack[1].search_state = SEARCH_WAIT;
@@ -268,9 +291,31 @@ void idle_loop(int id)
 				smp_block[id].input = 0;
 				smp_block[id].output = SMP_DONE;
 				break;
+			case SMP_CLEAR_HASH:
+				/* Clear our own tables for a new game. */
+				hash_clear_local();
+				smp_block[id].input = 0;
+				smp_block[id].output = SMP_DONE;
+				break;
+			case SMP_EVAL:
+				/* Help the master evaluate a batch of positions. */
+				smp_block[id].input = 0;
+				smp_block[id].output = SMP_DONE;
+				smp_block[id].root_move = -1;
+				evaluate_batch_work();
+				break;
+			case SMP_BITBASE:
+				/* Help the master generate a bitbase. */
+				smp_block[id].input = 0;
+				smp_block[id].output = SMP_DONE;
+				bitbase_generate_work();
+				break;
 			case SMP_IDLE:
 				/* After we are done searching, do a blocked read on our
-					pipe. This is so that we don't consume CPU time. */
+					pipe. This is so that we don't consume CPU time. Write
+					out our part of the trace first, so it's complete while
+					we're idle. */
+				trace_flush();
 				smp_block[id].input = 0;
 				smp_block[id].output = SMP_DONE;
 				read(smp_block[id].wait_pipe[0], buf, 1);
@@ -356,7 +401,7 @@ void smp_message(int id, SMP_MESSAGE_TYPE message, int data)
 smp_copy_to():
 In a parallel search, copies the board state (moves etc.) to shared memory
 on a split.
-Created 081706; last modified 022408
+Created 081706; last modified 101926
 **/
 void smp_copy_to(SPLIT_POINT *sp_to, GAME_ENTRY *ge, SEARCH_BLOCK *sb)
 {
@@ -402,6 +447,13 @@ void smp_copy_to(SPLIT_POINT *sp_to, GAME_ENTRY *ge, SEARCH_BLOCK *sb)
 	/* Copy the PVs. */
 	for (x = 0; x <= sb->ply; x++)
 		copy_pv(to->pv_stack[x], board.pv_stack[x]);
+	/* Take a snapshot of our killers for the plies below the split, so that
+		processors that join us can order their moves the same way. */
+	for (x = 0; x < SPLIT_KILLER_PLIES && sb->ply + 1 + x < MAX_PLY; x++)
+	{
+		sp_to->killer_move[x][0] = heuristics->killer_move[sb->ply + 1 + x][0];
+		sp_to->killer_move[x][1] = heuristics->killer_move[sb->ply + 1 + x][1];
+	}
 
 	/* Copy the search state. */
 	s_from = board.search_stack + 1;
@@ -415,6 +467,10 @@ void smp_copy_to(SPLIT_POINT *sp_to, GAME_ENTRY *ge, SEARCH_BLOCK *sb)
 			to->move_stack;
 		s_to->last_move = (s_from->last_move - board.move_stack) +
 			to->move_stack;
+		s_to->next_bad_cap = (s_from->next_bad_cap - board.move_stack) +
+			to->move_stack;
+		s_to->last_bad_cap = (s_from->last_bad_cap - board.move_stack) +
+			to->move_stack;
 		s_to++;
 		s_from++;
 	}
@@ -437,7 +493,7 @@ void smp_copy_to(SPLIT_POINT *sp_to, GAME_ENTRY *ge, SEARCH_BLOCK *sb)
 smp_copy_from():
 In a parallel search, copies the board state (moves etc.) from shared memory
 when we are joining a split point.
-Created 022308; last modified 022408
+Created 022308; last modified 101926
 **/
 void smp_copy_from(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 {
@@ -467,6 +523,19 @@ void smp_copy_from(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 	/* Copy the PVs. */
 	for (x = 0; x <= sb->ply; x++)
 		copy_pv(board.pv_stack[x], from->pv_stack[x]);
+	/* Install the owner's killers for the plies below the split. If the move
+		ordering tables are shared, we already have them, and the snapshot
+		could be older than what's in the table now. */
+	if (!zct->shared_heuristics)
+	{
+		for (x = 0; x < SPLIT_KILLER_PLIES && sb->ply + 1 + x < MAX_PLY; x++)
+		{
+			heuristics->killer_move[sb->ply + 1 + x][0] =
+				sp_from->killer_move[x][0];
+			heuristics->killer_move[sb->ply + 1 + x][1] =
+				sp_from->killer_move[x][1];
+		}
+	}
 
 	/* Copy the search state. */
 /*
@@ -495,6 +564,10 @@ void smp_copy_from(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 			board.move_stack;
 		s_to->last_move = (s_from->last_move - from->move_stack) +
 			board.move_stack;
+		s_to->next_bad_cap = (s_from->next_bad_cap - from->move_stack) +
+			board.move_stack;
+		s_to->last_bad_cap = (s_from->last_bad_cap - from->move_stack) +
+			board.move_stack;
 		s_to++;
 		s_from++;
 	}
@@ -516,7 +589,7 @@ void smp_copy_from(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 smp_copy_unsplit():
 In a parallel search, copies the board state (moves etc.) from shared memory
 when we are joining a split point.
-Created 111508; last modified 111508
+Created 111508; last modified 101926
 **/
 void smp_copy_unsplit(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 {
@@ -551,6 +624,10 @@ void smp_copy_unsplit(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 			board.move_stack;
 		s_to->last_move = (s_from->last_move - from->move_stack) +
 			board.move_stack;
+		s_to->next_bad_cap = (s_from->next_bad_cap - from->move_stack) +
+			board.move_stack;
+		s_to->last_bad_cap = (s_from->last_bad_cap - from->move_stack) +
+			board.move_stack;
 		s_to++;
 		s_from++;
 	}
@@ -560,7 +637,7 @@ void smp_copy_unsplit(SPLIT_POINT *sp_from, SEARCH_BLOCK *sb)
 smp_copy_root():
 At the beginning of a search, copy the root position so that we can coordinate
 the split points around it.
-Created 022308; last modified 022308
+Created 022308; last modified 101926
 **/
 void smp_copy_root(BOARD *to, BOARD *from)
 {
@@ -583,7 +660,13 @@ void smp_copy_root(BOARD *to, BOARD *from)
 		to->piece_count[x] = from->piece_count[x];
 		to->material[x] = from->material[x];
 		to->pawn_count[x] = from->pawn_count[x];
+		to->psq_opening[x] = from->psq_opening[x];
+		to->psq_endgame[x] = from->psq_endgame[x];
+		to->feature_acc[x][0] = from->feature_acc[x][0];
+		to->feature_acc[x][1] = from->feature_acc[x][1];
 	}
+	for (x = 0; x < 6; x++)
+		to->piece_type_count[x] = from->piece_type_count[x];
 	to->side_tm = from->side_tm;
 	to->side_ntm = from->side_ntm;
 	to->ep_square = from->ep_square;
@@ -648,7 +731,7 @@ handle_smp_input():
 During the search, there are synchronous messages sent between processors that
 need an immediate response. The sending processor must wait for the response.
 We handle these inputs here. It returns TRUE if we need to exit the search.
-Created 030109; last modified 030109
+Created 030109; last modified 101926
 **/
 BOOL handle_smp_input(SEARCH_BLOCK *sb)
 {
@@ -657,9 +740,11 @@ BOOL handle_smp_input(SEARCH_BLOCK *sb)
 	/* See if someone is telling us to split. */
 	if (smp_block[board.id].input == SMP_SPLIT)
 	{
-		/* If we're in an idle state, just send an error message back. */
+		/* If we're in an idle state, just send an error message back. The
+			same goes for a root move searched in parallel, which might have
+			been picked as a candidate before the move was taken. */
 		if (sb->search_state == SEARCH_CHILD_RETURN ||
-				sb->search_state == SEARCH_WAIT)
+				sb->search_state == SEARCH_WAIT || root_split_searching())
 		{
 			smp_block[board.id].input = 0;
 			smp_block[board.id].data = -1;
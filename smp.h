@@ -45,6 +45,8 @@
 
 #define MAX_SPLIT_POINTS		(MAX_CPUS * MAX_CPUS)
 #define MAX_MESSAGES			(32)
+/* The number of plies below a split point that it keeps killers for */
+#define SPLIT_KILLER_PLIES		(16)
 
 #ifdef ZCT_OSX
 
@@ -117,7 +119,8 @@ DWORD WINAPI thread_init(LPVOID arg);
 	Look for the functions that implement their actions to get a better idea
 	of what each command does. */
 typedef enum { SMP_INIT = 1, SMP_SEARCH, SMP_PARK, SMP_SPLIT, SMP_PERFT,
-	SMP_UPDATE_HASH, SMP_IDLE } SMP_INPUT;
+	SMP_UPDATE_HASH, SMP_CLEAR_HASH, SMP_IDLE, SMP_EVAL,
+	SMP_BITBASE } SMP_INPUT;
 typedef enum { SMP_DONE = 1 } SMP_OUTPUT;
 /* These are asynchronous commands, meaning that the sending processor does
 	not wait for a reply. */
@@ -144,6 +147,7 @@ typedef struct SPLIT_POINT
 	BOOL update[MAX_CPUS];
 	MOVE move_list[256];
 	MOVE pv[MAX_PLY];
+	MOVE killer_move[SPLIT_KILLER_PLIES][2];
 	SEARCH_BLOCK * volatile sb;
 //	SPLIT_SCORE score;
 	LOCK_T lock; /* Used for all data in each split point */
@@ -177,6 +181,39 @@ typedef struct CACHE_ALIGNED
 	int best_ply;
 } TREE_BLOCK;
 
+/* Root moves that are searched in parallel are handed out from a shared
+	table. Each move is searched with a zero window around the shared alpha,
+	which is raised by whichever processor finds a new best move. */
+typedef enum { ROOT_SPLIT_OPEN, ROOT_SPLIT_SEARCHING,
+	ROOT_SPLIT_DONE } ROOT_SPLIT_STATE;
+
+typedef struct
+{
+	int index; /* the slot in zct->root_move_list[] */
+	MOVE move;
+	VALUE value;
+	BITBOARD nodes;
+	volatile ROOT_SPLIT_STATE state;
+	MOVE pv[MAX_PLY];
+} ROOT_SPLIT_MOVE;
+
+typedef struct CACHE_ALIGNED
+{
+	volatile BOOL active;
+	volatile BOOL fail_high;
+	volatile BOOL waiting; /* the main processor is waiting for the rest */
+	int depth;
+	volatile VALUE alpha;
+	VALUE beta;
+	int move_count;
+	volatile int next_move;
+	volatile int outstanding;
+	volatile int best_move;
+	int pv_changes;
+	ROOT_SPLIT_MOVE move[MAX_ROOT_MOVES];
+	LOCK_T lock;
+} ROOT_SPLIT;
+
 /* Wrapper struct for each process, used for communication */
 typedef struct CACHE_ALIGNED
 {
@@ -184,6 +221,7 @@ typedef struct CACHE_ALIGNED
 	PID pid;
 	BITBOARD nodes;
 	BITBOARD q_nodes;
+	SEARCH_COUNTERS counters;
 	int idle_time;
 	int last_idle_time;
 	int wait;
@@ -202,10 +240,24 @@ typedef struct CACHE_ALIGNED
 	/* Split point data. */
 	ID split_id;
 
+	/* The root move that we are searching in parallel, or -1. */
+	int root_move;
+	BOOL root_research;
+	VALUE root_alpha;
+	BITBOARD root_nodes;
+
 	LOCK_T lock;
 	LOCK_T input_lock; /* Used for all input/output */
 } SMP_BLOCK;
 
+/* Positions are handed out to the processors for batch evaluation in chunks
+	of EVAL_BATCH_CHUNK, out of at most EVAL_BATCH_SIZE at a time. The eval
+	parameters are sent along too, since they can change between batches
+	when tuning. */
+#define EVAL_BATCH_SIZE			(4096)
+#define EVAL_BATCH_CHUNK		(64)
+#define EVAL_BATCH_PARAMS		(2048)
+
 /* Wrapper struct for global smp data */
 typedef struct CACHE_ALIGNED
 {
@@ -215,6 +267,22 @@ typedef struct CACHE_ALIGNED
 	BOOL return_flag;
 	int return_value;
 	MOVE return_pv[MAX_PLY];
+	ROOT_SPLIT root_split;
+	/* Batch evaluation */
+	PACKED_POS batch_pos[EVAL_BATCH_SIZE];
+	VALUE batch_score[EVAL_BATCH_SIZE];
+	VALUE batch_param[EVAL_BATCH_PARAMS];
+	BATCH_TYPE batch_type;
+	volatile int batch_count;
+	volatile int batch_next;
+	volatile int batch_done;
+	LOCK_T batch_lock;
+	/* Bitbase generation */
+	int bitbase_id;
+	volatile BITBOARD bitbase_next;
+	volatile BITBOARD bitbase_done;
+	volatile BOOL bitbase_changed;
+	LOCK_T bitbase_lock;
 	LOCK_T lock; /* Used for general smp data, split points, etc. */
 	LOCK_T io_lock; /* Used for all input/output */
 } SMP_DATA;
@@ -257,11 +325,21 @@ void copy_search_state(SEARCH_BLOCK *sb, int process);
 void smp_wait(SEARCH_BLOCK **sb);
 void update_best_sb(SEARCH_BLOCK *sb, BOOL recalculate);
 int find_split_point(void);
+BOOL root_split_search(int depth, VALUE *alpha, VALUE beta);
+BOOL root_split_attach(SEARCH_BLOCK **sb);
+void root_split_result(int n, VALUE value, BOOL full_window, BITBOARD nodes,
+	MOVE *pv);
+void root_split_abort(SEARCH_BLOCK **sb);
+BOOL root_split_searching(void);
+
+/* The search counters are counted by each processor in its own block. */
+#define COUNTER_INC(c)			(smp_block[board.id].counters.c++)
 
 #else
 
 #define LOCK(x)
 #define UNLOCK(x)
+#define COUNTER_INC(c)			(zct->counters.c++)
 
 #endif /* SMP */
 
@@ -576,7 +576,7 @@ While an idle processor is looping in search, waiting for some work, it will
 have to look at the search state of other processors. We check if there are any
 active split points and try to split there, otherwise we find the best node for
 a split point and tell the processor that owns it to split.
-Created 102608; last modified 123008
+Created 102608; last modified 101926
 **/
 void smp_wait(SEARCH_BLOCK **sb)
 {
@@ -585,6 +585,10 @@ void smp_wait(SEARCH_BLOCK **sb)
 	SEARCH_BLOCK *temp;
 	int x;
 
+	/* Root moves are the biggest pieces of work around, so look there first. */
+	if (root_split_attach(sb))
+		return;
+
 	/* If a split point already exists, attach to that. */
 	for (x = 0; x < MAX_SPLIT_POINTS; x++)
 		if (split_point[x].active && !split_point[x].no_moves_left &&
@@ -660,7 +664,7 @@ void initialize_split_score(SPLIT_SCORE *ss)
 /**
 score_split_point():
 Take a SEARCH_BLOCK of a tree state and evaluate it as a potential split point.
-Created 090408; last modified 031709
+Created 090408; last modified 101926
 **/
 float score_split_point(SEARCH_BLOCK *sb, SPLIT_SCORE *ss)
 {
@@ -671,6 +675,13 @@ float score_split_point(SEARCH_BLOCK *sb, SPLIT_SCORE *ss)
 	float moves_score;
 	
 	moves_to_go = sb->last_move - sb->next_move;
+	/* With staged move generation, the bad captures are searched after the
+		quiet moves, and before the quiet stage the quiets haven't even been
+		generated yet, so just assume there are plenty of them. */
+	if (sb->select_state >= SELECT_QUIETS)
+		moves_to_go += sb->last_bad_cap - sb->next_bad_cap;
+	else if (sb->select_state >= SELECT_GOOD_CAPS)
+		moves_to_go += 10;
 	/* Make sure this is a valid node to split at. */
 	if (sb->is_qsearch ||
 		sb->search_state == SEARCH_RETURN ||
@@ -720,7 +731,7 @@ update_best_sb():
 Whenever a node is updated in the tree, we check it against our best split
 point candidate. This way we maintain for each processor the best place to
 split, so that other processors can quickly examine our search space.
-Created 090308; last modified 031909
+Created 090308; last modified 101926
 **/
 void update_best_sb(SEARCH_BLOCK *sb, BOOL recalculate)
 {
@@ -733,6 +744,13 @@ void update_best_sb(SEARCH_BLOCK *sb, BOOL recalculate)
 
 	if (sb->depth < 2 * PLY)
 		return;
+	/* Root moves searched in parallel are never split. Drop any candidate
+		left over from before, so nobody tries to split there. */
+	if (root_split_searching())
+	{
+		smp_block[board.id].tree.best_score = -1;
+		return;
+	}
 
 	tb = &smp_block[board.id].tree;
 	sply = *board.split_ply;
@@ -824,4 +842,275 @@ int find_split_point(void)
 	return -2;
 }
 
+/**
+root_split_search():
+Once the first root move has been searched, the rest of the root moves are put
+into a shared table, where idle processors can take them and search them with a
+zero window around a shared alpha. The main processor searches moves from the
+table too, and then waits for everyone else to finish, or stops them if the
+root failed high. The results are then copied back into the root move list.
+Returns TRUE if the search was stopped.
+Created 101926; last modified 101926
+**/
+BOOL root_split_search(int depth, VALUE *alpha, VALUE beta)
+{
+	ROOT_SPLIT *rs;
+	ROOT_SPLIT_MOVE *rsm;
+	ROOT_MOVE *move;
+	BITBOARD nodes;
+	VALUE value;
+	VALUE a;
+	BOOL full_window;
+	int n;
+
+	rs = &smp_data->root_split;
+
+	/* Fill the table with the remaining moves, in the usual order. */
+	LOCK(rs->lock);
+	rs->move_count = 0;
+	while ((move = select_root_move()) != NULL)
+	{
+		rsm = &rs->move[rs->move_count++];
+		rsm->index = move - zct->root_move_list;
+		rsm->move = move->move;
+		rsm->state = ROOT_SPLIT_OPEN;
+	}
+	rs->depth = depth;
+	rs->alpha = *alpha;
+	rs->beta = beta;
+	rs->next_move = 0;
+	rs->outstanding = 0;
+	rs->best_move = -1;
+	rs->pv_changes = 0;
+	rs->fail_high = FALSE;
+	rs->waiting = FALSE;
+	rs->active = TRUE;
+	UNLOCK(rs->lock);
+
+	while (TRUE)
+	{
+		LOCK(rs->lock);
+		if (rs->fail_high || rs->next_move >= rs->move_count)
+		{
+			UNLOCK(rs->lock);
+			break;
+		}
+		n = rs->next_move++;
+		rs->move[n].state = ROOT_SPLIT_SEARCHING;
+		rs->outstanding++;
+		a = rs->alpha;
+		UNLOCK(rs->lock);
+
+		/* search_maintenance() uses this to find the move to make when a
+			helper returns to the root. */
+		zct->next_root_move = &zct->root_move_list[rs->move[n].index + 1];
+
+		nodes = smp_block[board.id].nodes + smp_block[board.id].q_nodes;
+		make_move(rs->move[n].move);
+		search_call(&board.search_stack[0], FALSE, depth, 1, -a - 1, -a,
+			&board.move_stack[0], NODE_PV, SEARCH_RETURN);
+		value = -search(&board.search_stack[1]);
+		full_window = FALSE;
+		if (value > a && !rs->fail_high)
+		{
+			a = rs->alpha;
+			search_call(&board.search_stack[0], FALSE, depth, 1, -beta, -a,
+				&board.move_stack[0], NODE_PV, SEARCH_RETURN);
+			value = -search(&board.search_stack[1]);
+			full_window = TRUE;
+		}
+		unmake_move();
+
+		if (stop_search())
+		{
+			rs->active = FALSE;
+			return TRUE;
+		}
+		/* A helper failed high while we were searching, and our search was
+			stopped in search_maintenance(), so our move doesn't count. */
+		if (!rs->active)
+			break;
+		root_split_result(n, value, full_window, smp_block[board.id].nodes +
+			smp_block[board.id].q_nodes - nodes, board.pv_stack[1]);
+	}
+
+	/* If the root failed high, the moves still being searched can't matter
+		anymore. Instead of waiting for the helpers to notice, stop them and
+		start them up again for the re-search. */
+	if (rs->fail_high)
+	{
+		rs->active = FALSE;
+		stop_child_processors();
+		start_child_processors();
+	}
+	/* Otherwise, wait for the other processors to finish their moves. We do
+		this in the search like any other idle processor, so that input and
+		time are still checked. search_maintenance() returns once all the
+		moves are done. */
+	else if (rs->outstanding > 0)
+	{
+		rs->waiting = TRUE;
+		set_idle();
+		board.search_stack[0].search_state = SEARCH_CHILD_RETURN;
+		board.search_stack[1].search_state = SEARCH_WAIT;
+		search(&board.search_stack[1]);
+		rs->waiting = FALSE;
+		set_active();
+
+		/* A timeout backs up to the root with a root move made. */
+		if (board.game_entry > root_entry)
+			unmake_move();
+		if (stop_search())
+		{
+			rs->active = FALSE;
+			return TRUE;
+		}
+	}
+	rs->active = FALSE;
+	zct->next_root_move = &zct->root_move_list[zct->root_move_count];
+
+	/* Copy the results back into the root move list, so that the move
+		ordering for the next iteration still works. */
+	for (n = 0; n < rs->move_count; n++)
+	{
+		rsm = &rs->move[n];
+		if (rsm->state != ROOT_SPLIT_DONE)
+			continue;
+		move = &zct->root_move_list[rsm->index];
+		move->nodes = rsm->nodes - move->last_nodes;
+		move->last_nodes = rsm->nodes;
+		move->last_score = rsm->value;
+		copy_pv(move->pv, rsm->pv);
+	}
+
+	/* Update and display the new PV. */
+	if (rs->best_move != -1)
+	{
+		rsm = &rs->move[rs->best_move];
+		*alpha = rs->alpha;
+		zct->root_move_list[rsm->index].score = ++zct->root_pv_counter;
+		zct->best_score_by_depth[zct->current_iteration] = *alpha;
+		zct->pv_changes_by_depth[zct->current_iteration] += rs->pv_changes;
+		copy_pv(board.pv_stack[0], rsm->pv);
+		display_search_line(FALSE, board.pv_stack[0], *alpha);
+	}
+	return FALSE;
+}
+
+/**
+root_split_attach():
+Called by an idle processor to take a move from the shared root move table.
+The move is made and a zero window search is set up with SEARCH_ROOT_RETURN as
+the return state. Returns TRUE if a move was found.
+Created 101926; last modified 101926
+**/
+BOOL root_split_attach(SEARCH_BLOCK **sb)
+{
+	ROOT_SPLIT *rs;
+	SMP_BLOCK *block;
+	int n;
+
+	/* The main processor takes its root moves in root_split_search(). */
+	rs = &smp_data->root_split;
+	if (board.id == 0 || !rs->active || rs->fail_high ||
+		rs->next_move >= rs->move_count)
+		return FALSE;
+
+	block = &smp_block[board.id];
+	LOCK(rs->lock);
+	if (!rs->active || rs->fail_high || rs->next_move >= rs->move_count)
+	{
+		UNLOCK(rs->lock);
+		return FALSE;
+	}
+	n = rs->next_move++;
+	rs->move[n].state = ROOT_SPLIT_SEARCHING;
+	rs->outstanding++;
+	block->root_move = n;
+	block->root_research = FALSE;
+	block->root_alpha = rs->alpha;
+	UNLOCK(rs->lock);
+
+	ASSERT(board.game_entry == root_entry);
+	block->root_nodes = block->nodes + block->q_nodes;
+	set_active();
+	make_move(rs->move[n].move);
+	search_call(&board.search_stack[0], FALSE, rs->depth, 1,
+		-block->root_alpha - 1, -block->root_alpha, &board.move_stack[0],
+		NODE_PV, SEARCH_ROOT_RETURN);
+	*sb = &board.search_stack[1];
+	return TRUE;
+}
+
+/**
+root_split_result():
+Stores the result of a root move searched in parallel in the shared table. A
+full window score above the shared alpha makes the move the new best move.
+Created 101926; last modified 101926
+**/
+void root_split_result(int n, VALUE value, BOOL full_window, BITBOARD nodes,
+	MOVE *pv)
+{
+	ROOT_SPLIT *rs;
+	ROOT_SPLIT_MOVE *rsm;
+
+	rs = &smp_data->root_split;
+	rsm = &rs->move[n];
+
+	LOCK(rs->lock);
+	rsm->value = value;
+	rsm->nodes = nodes;
+	rsm->pv[0] = rsm->move;
+	copy_pv(rsm->pv + 1, pv);
+	if (full_window && value > rs->alpha)
+	{
+		rs->alpha = value;
+		rs->best_move = n;
+		rs->pv_changes++;
+		if (value >= rs->beta)
+			rs->fail_high = TRUE;
+	}
+	rsm->state = ROOT_SPLIT_DONE;
+	rs->outstanding--;
+	UNLOCK(rs->lock);
+}
+
+/**
+root_split_abort():
+Drops the root move that we are searching in parallel, after the root has
+failed high, and goes back to waiting for work.
+Created 101926; last modified 101926
+**/
+void root_split_abort(SEARCH_BLOCK **sb)
+{
+	LOCK(smp_data->root_split.lock);
+	smp_data->root_split.outstanding--;
+	UNLOCK(smp_data->root_split.lock);
+	smp_block[board.id].root_move = -1;
+
+	/* We never split inside a root move, so there are no split points to
+		detach from. Just back up to the root. */
+	board.search_stack[0].search_state = SEARCH_CHILD_RETURN;
+	*sb = &board.search_stack[1];
+	stop(*sb);
+}
+
+/**
+root_split_searching():
+Returns TRUE if we are searching a root move taken from the shared root move
+table. A helper has its move in root_move, but the main processor searches its
+moves from root_split_search() without one, so it is searching one whenever
+the table is active and it isn't waiting for the others. Split points are
+never made inside these moves, because their results go straight into the
+shared table, and the moves are dropped as soon as the root fails high.
+Created 101926; last modified 101926
+**/
+BOOL root_split_searching(void)
+{
+	if (smp_block[board.id].root_move != -1)
+		return TRUE;
+	return (board.id == 0 && smp_data->root_split.active &&
+		!smp_data->root_split.waiting);
+}
+
 #endif /* SMP */
@@ -22,6 +22,8 @@
 #include "globals.h"
 #include "cmd.h"
 #include "pgn.h"
+#include "eval.h"
+#include "bit.h"
 #include <math.h>
 
 BOOL correct;
@@ -160,25 +162,52 @@ void test_epd_eval(char *file_name)
 /**
 eval_test_pos_func():
 When running through a test suite, take the current position and make sure
-that it has the same evaluation after being flipped.
-Created 111208; last modified 111208
+that it has the same evaluation after being flipped. The passed pawn paths
+are also checked against the square-by-square version.
+Created 111208; last modified 101926
 **/
 BOOL eval_test_pos_func(void *arg, POS_DATA *pos)
 {
+	BOOL passed;
+	BITBOARD pawns;
 	EVAL_BLOCK eval_block;
+	SQUARE square;
 	VALUE old_eval;
 	VALUE new_eval;
 
+	passed = TRUE;
 	old_eval = evaluate(&eval_block);
+
+	/* The evaluation can return early on an eval hash hit, leaving the
+		pawn entry of some other position on the board, so evaluate the pawns
+		again to get this position's. */
+	evaluate_pawns();
+	find_exact_attacks();
+	pawns = board.pawn_entry.passed_pawns;
+	FOR_BB(square, pawns)
+	{
+		if (passed_pawn_path(square, board.color[square]) !=
+			passed_pawn_path_scalar(square, board.color[square]))
+		{
+			print("failed: passed pawn path %S: %i != %i\nfen=%F\n", square,
+				passed_pawn_path(square, board.color[square]),
+				passed_pawn_path_scalar(square, board.color[square]), &board);
+			passed = FALSE;
+		}
+	}
+
 	flip_board();
 	new_eval = evaluate(&eval_block);
 	/* Flip the board back, in case we're reading a PGN or something... */
 	flip_board();
 
 	if (old_eval != new_eval)
+	{
 		print("failed: old=%V new=%V\nfen=%F\n%B",
 			old_eval, new_eval, &board, &board);
-	else
+		passed = FALSE;
+	}
+	if (passed)
 		correct_count++;
 
 	return FALSE;
@@ -0,0 +1,400 @@
+/** ZCT/trace.c--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+#include "functions.h"
+#include "globals.h"
+#include "smp.h"
+#include "trace.h"
+
+/* The number of cutoff positions that are counted separately. Cutoffs after
+	that are all counted in the last one. */
+#define TRACE_CUT_POSITIONS		(4)
+
+/* The ring and the file for this processor, and the trace they belong to */
+THREAD_LOCAL TRACE_RECORD *trace_ring = NULL;
+THREAD_LOCAL int trace_count = 0;
+THREAD_LOCAL FILE *trace_file = NULL;
+THREAD_LOCAL int trace_generation = 0;
+
+static const char trace_magic[8] = "ZCTTRACE";
+
+/**
+trace_file_name():
+Puts the name of the trace file for the given processor into file_name.
+Created 101926; last modified 101926
+**/
+void trace_file_name(char *file_name, int size, char *name, int id)
+{
+	sprint(file_name, size, "%s.%i", name, id);
+}
+
+/**
+trace_open():
+Opens the trace file for this processor and writes the header. Returns FALSE
+if the file can't be opened.
+Created 101926; last modified 101926
+**/
+BOOL trace_open(void)
+{
+	char file_name[BUFSIZ];
+	TRACE_HEADER header;
+
+	trace_close();
+	memcpy(header.magic, trace_magic, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(TRACE_RECORD);
+#ifdef SMP
+	header.id = board.id;
+#else
+	header.id = 0;
+#endif
+	trace_file_name(file_name, sizeof(file_name), zct->trace_name, header.id);
+	if ((trace_file = fopen(file_name, "wb")) == NULL)
+		return FALSE;
+	if ((trace_ring = malloc(TRACE_RING_SIZE * sizeof(TRACE_RECORD))) == NULL)
+		fatal_error("fatal error: could not allocate trace ring");
+	fwrite(&header, sizeof(header), 1, trace_file);
+	trace_count = 0;
+	trace_generation = zct->trace_generation;
+	return TRUE;
+}
+
+/**
+trace_close():
+Writes out whatever is left in the ring and closes the trace file.
+Created 101926; last modified 101926
+**/
+void trace_close(void)
+{
+	if (trace_file == NULL)
+		return;
+	fwrite(trace_ring, sizeof(TRACE_RECORD), trace_count, trace_file);
+	fclose(trace_file);
+	free(trace_ring);
+	trace_file = NULL;
+	trace_ring = NULL;
+	trace_count = 0;
+}
+
+/**
+trace_start():
+Starts a new trace with the given name. The master opens its file right away,
+so that a bad name is caught here. The other processors open theirs when they
+record their first node. Returns FALSE if the file can't be opened.
+Created 101926; last modified 101926
+**/
+BOOL trace_start(char *name)
+{
+	strncpy(zct->trace_name, name, sizeof(zct->trace_name) - 1);
+	zct->trace_name[sizeof(zct->trace_name) - 1] = '\0';
+	zct->trace_generation++;
+	if (!trace_open())
+	{
+		zct->trace = FALSE;
+		return FALSE;
+	}
+	zct->trace = TRUE;
+	return TRUE;
+}
+
+/**
+trace_stop():
+Stops tracing. The other processors close their files the next time they go
+idle, but everything they recorded has already been written by then.
+Created 101926; last modified 101926
+**/
+void trace_stop(void)
+{
+	zct->trace = FALSE;
+	trace_close();
+}
+
+/**
+trace_flush():
+Writes out the ring for this processor. This is done at the end of every
+search, so that the files are complete while the engine is idle. If tracing
+was stopped or restarted since the file was opened, the file is closed.
+Created 101926; last modified 101926
+**/
+void trace_flush(void)
+{
+	if (trace_file == NULL)
+		return;
+	if (!zct->trace || trace_generation != zct->trace_generation)
+	{
+		trace_close();
+		return;
+	}
+	fwrite(trace_ring, sizeof(TRACE_RECORD), trace_count, trace_file);
+	fflush(trace_file);
+	trace_count = 0;
+}
+
+/**
+trace_next():
+Returns the next free record in the ring, writing the ring out if it is full.
+Created 101926; last modified 101926
+**/
+TRACE_RECORD *trace_next(void)
+{
+	if (trace_file == NULL || trace_generation != zct->trace_generation)
+	{
+		if (!trace_open())
+			fatal_error("fatal error: could not open trace file for %s",
+				zct->trace_name);
+	}
+	else if (trace_count == TRACE_RING_SIZE)
+	{
+		fwrite(trace_ring, sizeof(TRACE_RECORD), trace_count, trace_file);
+		trace_count = 0;
+	}
+	return &trace_ring[trace_count++];
+}
+
+/**
+trace_call():
+Records a new node. This is called from search_call(), after the search block
+for the node has been set up.
+Created 101926; last modified 101926
+**/
+void trace_call(SEARCH_BLOCK *sb)
+{
+	TRACE_RECORD *record;
+
+	record = trace_next();
+	record->type = TRACE_CALL;
+	record->ply = sb->ply;
+	record->state = (sb - 1)->search_state;
+	record->flags = sb->is_qsearch ? TRACE_QSEARCH : 0;
+	record->depth = sb->depth;
+	record->alpha = sb->alpha;
+	record->beta = sb->beta;
+	record->value = 0;
+	record->moves = 0;
+	record->best = 0;
+	/* The root doesn't set its move in the search block, so take the move
+		that led here from the game stack. */
+	if (board.game_entry > board.game_stack)
+		record->move = (board.game_entry - 1)->move;
+	else
+		record->move = NO_MOVE;
+}
+
+/**
+trace_hash():
+Records a hash hit at a node, and whether it caused a cutoff.
+Created 101926; last modified 101926
+**/
+void trace_hash(SEARCH_BLOCK *sb, BOOL cut)
+{
+	TRACE_RECORD *record;
+
+	record = trace_next();
+	record->type = TRACE_HASH;
+	record->ply = sb->ply;
+	record->state = sb->search_state;
+	record->flags = (sb->is_qsearch ? TRACE_QSEARCH : 0) |
+		(cut ? TRACE_HASH_CUT : 0);
+	record->depth = sb->depth;
+	record->alpha = sb->alpha;
+	record->beta = sb->beta;
+	record->value = 0;
+	record->moves = 0;
+	record->best = 0;
+	record->move = sb->hash_move;
+}
+
+/**
+trace_return():
+Records the value returned from a node. The state is the one the node was in
+when it returned, which tells where in the node the search ended.
+Created 101926; last modified 101926
+**/
+void trace_return(SEARCH_BLOCK *sb, VALUE value)
+{
+	TRACE_RECORD *record;
+
+	record = trace_next();
+	record->type = TRACE_RETURN;
+	record->ply = sb->ply;
+	record->state = sb->search_state;
+	record->flags = sb->is_qsearch ? TRACE_QSEARCH : 0;
+	record->depth = sb->depth;
+	record->alpha = sb->alpha;
+	record->beta = sb->beta;
+	record->value = value;
+	record->moves = sb->moves;
+	record->best = sb->pv_found;
+	record->move = sb->pv_found ? board.pv_stack[sb->ply][0] : NO_MOVE;
+}
+
+/**
+trace_summary():
+Reads back the trace files with the given name, one for each processor, and
+prints a summary of the tree: nodes and moves searched per ply, where the
+cutoffs happened, hash hits, and how often each kind of search was done,
+including re-searches.
+Created 101926; last modified 101926
+**/
+void trace_summary(char *name)
+{
+	static BITBOARD nodes[MAX_PLY];
+	static BITBOARD q_nodes[MAX_PLY];
+	static BITBOARD expanded[MAX_PLY];
+	static BITBOARD moves[MAX_PLY];
+	static BITBOARD fail_highs[MAX_PLY];
+	static BITBOARD cut_position[MAX_PLY][TRACE_CUT_POSITIONS];
+	static BITBOARD hash_hits[MAX_PLY];
+	static BITBOARD hash_cuts[MAX_PLY];
+	BITBOARD calls_by_state[SEARCH_RETURN + 1];
+	BITBOARD records;
+	BITBOARD root_searches;
+	BITBOARD root_researches;
+	char file_name[BUFSIZ];
+	int files;
+	int x;
+	int y;
+	int count;
+	MOVE last_root_move;
+	FILE *file;
+	TRACE_HEADER header;
+	TRACE_RECORD *ring;
+	TRACE_RECORD *record;
+
+	for (x = 0; x < MAX_PLY; x++)
+	{
+		nodes[x] = q_nodes[x] = expanded[x] = moves[x] = fail_highs[x] = 0;
+		hash_hits[x] = hash_cuts[x] = 0;
+		for (y = 0; y < TRACE_CUT_POSITIONS; y++)
+			cut_position[x][y] = 0;
+	}
+	for (x = 0; x <= SEARCH_RETURN; x++)
+		calls_by_state[x] = 0;
+	records = root_searches = root_researches = 0;
+	if ((ring = malloc(TRACE_RING_SIZE * sizeof(TRACE_RECORD))) == NULL)
+		fatal_error("fatal error: could not allocate trace ring");
+
+	for (files = 0; files < MAX_CPUS; files++)
+	{
+		trace_file_name(file_name, sizeof(file_name), name, files);
+		if ((file = fopen(file_name, "rb")) == NULL)
+			break;
+		if (fread(&header, sizeof(header), 1, file) != 1 ||
+			memcmp(header.magic, trace_magic, sizeof(header.magic)) ||
+			header.version != TRACE_VERSION ||
+			header.record_size != sizeof(TRACE_RECORD))
+		{
+			print("%s is not a trace file from this version of ZCT.\n",
+				file_name);
+			fclose(file);
+			break;
+		}
+
+		last_root_move = NO_MOVE;
+		while ((count = fread(ring, sizeof(TRACE_RECORD), TRACE_RING_SIZE,
+			file)) > 0)
+		{
+			records += count;
+			for (record = ring; record < ring + count; record++)
+			{
+				if (record->ply >= MAX_PLY)
+					continue;
+				switch (record->type)
+				{
+					case TRACE_CALL:
+						if (record->state <= SEARCH_RETURN)
+							calls_by_state[record->state]++;
+						if (record->flags & TRACE_QSEARCH)
+							q_nodes[record->ply]++;
+						else
+							nodes[record->ply]++;
+						/* The root moves are searched from search_root() on
+							the master, which returns to SEARCH_RETURN. A root
+							move searched twice in a row is a re-search. */
+						if (record->ply == 1 && record->state == SEARCH_RETURN)
+						{
+							root_searches++;
+							if (record->move == last_root_move)
+								root_researches++;
+							last_root_move = record->move;
+						}
+						break;
+					case TRACE_HASH:
+						hash_hits[record->ply]++;
+						if (record->flags & TRACE_HASH_CUT)
+							hash_cuts[record->ply]++;
+						break;
+					case TRACE_RETURN:
+						if ((record->flags & TRACE_QSEARCH) ||
+							record->moves == 0)
+							break;
+						expanded[record->ply]++;
+						moves[record->ply] += record->moves;
+						if (record->value >= record->beta && record->best > 0)
+						{
+							fail_highs[record->ply]++;
+							cut_position[record->ply][MIN(record->best,
+								TRACE_CUT_POSITIONS) - 1]++;
+						}
+						break;
+				}
+			}
+		}
+		fclose(file);
+	}
+	free(ring);
+
+	if (files == 0)
+	{
+		print("Could not open %s.\n", file_name);
+		return;
+	}
+	print("trace: files=%i records=%L\n", files, records);
+	print("ply        nodes      qnodes  growth  moves/node  fail highs"
+		"  cut@1  cut@2  cut@3  cut@4+   hash hits  hash cuts\n");
+	for (x = 1; x < MAX_PLY; x++)
+	{
+		if (nodes[x] + q_nodes[x] == 0)
+			continue;
+		print("%3i %12L %11L %7.2f %11.2f %11L", x, nodes[x], q_nodes[x],
+			nodes[x - 1] ? (float)nodes[x] / nodes[x - 1] : 0.0,
+			expanded[x] ? (float)moves[x] / expanded[x] : 0.0,
+			fail_highs[x]);
+		for (y = 0; y < TRACE_CUT_POSITIONS; y++)
+			print(" %5.1f%%", fail_highs[x] ? (float)100.0 *
+				cut_position[x][y] / fail_highs[x] : 0.0);
+		print(" %11L %10L\n", hash_hits[x], hash_cuts[x]);
+	}
+
+	print("calls:");
+	for (x = 0; x <= SEARCH_RETURN; x++)
+	{
+		if (calls_by_state[x])
+			print(" %R=%L", x, calls_by_state[x]);
+	}
+	print("\n");
+	print("re-searches: pv=%L/%.1f%% reduced=%L/%.1f%% root=%L/%.1f%%\n",
+		calls_by_state[SEARCH_2], calls_by_state[SEARCH_1] ?
+		(float)100.0 * calls_by_state[SEARCH_2] / calls_by_state[SEARCH_1] :
+		0.0, calls_by_state[SEARCH_4], calls_by_state[SEARCH_3] ?
+		(float)100.0 * calls_by_state[SEARCH_4] / calls_by_state[SEARCH_3] :
+		0.0, root_researches, root_searches ?
+		(float)100.0 * root_researches / root_searches : 0.0);
+}
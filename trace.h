@@ -0,0 +1,82 @@
+/** ZCT/trace.h--Created 101926 **/
+
+/** Copyright 2008 Zach Wegner **/
+/*
+ * This file is part of ZCT.
+ *
+ * ZCT is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ZCT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ZCT.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "zct.h"
+
+#ifndef	TRACE_H
+#define TRACE_H
+
+/* The search tree trace. While tracing is on, each processor records every
+	node it visits into a ring in memory, and writes the ring out to its own
+	file (the trace name followed by the processor number) whenever it fills
+	up, and at the end of each search. The files are read back by the "trace
+	summary" command. */
+
+#define TRACE_RING_SIZE			(1 << 16)
+#define TRACE_VERSION			(1)
+
+typedef enum { TRACE_CALL, TRACE_HASH, TRACE_RETURN } TRACE_TYPE;
+
+/* Flags */
+#define TRACE_QSEARCH			(1)
+#define TRACE_HASH_CUT			(2)
+
+/* One event in the trace. For TRACE_CALL, the move is the one that led to the
+	node, the state is the one the parent resumes in when the node returns, and
+	alpha and beta are the window. For TRACE_HASH, the move is the hash move.
+	For TRACE_RETURN, value is the score returned, moves is the number of moves
+	searched, and best is the number of the last move that raised alpha. */
+typedef struct
+{
+	unsigned char type;
+	unsigned char ply;
+	unsigned char state;
+	unsigned char flags;
+	short depth;
+	short alpha;
+	short beta;
+	short value;
+	short moves;
+	short best;
+	MOVE move;
+} TRACE_RECORD;
+
+/* The header at the start of each trace file */
+typedef struct
+{
+	char magic[8];
+	int version;
+	int record_size;
+	int id;
+} TRACE_HEADER;
+
+/* prototypes */
+void trace_file_name(char *file_name, int size, char *name, int id);
+BOOL trace_open(void);
+void trace_close(void);
+BOOL trace_start(char *name);
+void trace_stop(void);
+void trace_flush(void);
+TRACE_RECORD *trace_next(void);
+void trace_call(SEARCH_BLOCK *sb);
+void trace_hash(SEARCH_BLOCK *sb, BOOL cut);
+void trace_return(SEARCH_BLOCK *sb, VALUE value);
+void trace_summary(char *name);
+
+#endif /* TRACE_H */
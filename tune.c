@@ -21,266 +21,644 @@
 #include "functions.h"
 #include "globals.h"
 #include "eval.h"
+#include "cmd.h"
 #include "pgn.h"
 #include <math.h>
 
-void modify_eval(EVAL_PARAMETER *param, int stagnancy);
-BOOL tune_pgn_func(void *pgn_arg, PGN_GAME *pgn_game);
+/* State for extracting tuning positions from a PGN. Positions that pass the
+	cheap filters are queued up, and the qsearch filter is run on them in
+	batches of EXTRACT_BATCH. */
+#define EXTRACT_BATCH	(16384)
 
-EVAL_PARAMETER old_params[128];
-
-/* Tuning data. We keep track of the number of positions we evaluate, as well
-	as the result of the games. We then keep an average of the evaluation and
-	an average of a certain parameter (or set of parameters). */
 typedef struct
 {
-	unsigned int count;
-	unsigned int points;
-	signed long long total;
-	signed long long param_total;
-} TUNE_DATA;
+	FILE *file;
+	BOOL fen;
+	BOOL decisive;
+	int min_ply;
+	VALUE margin;
+	VALUE max_balance;
+	PACKED_POS *pos;
+	VALUE *eval;
+	VALUE *q_eval;
+	char (*fen_string)[128];
+	int count;
+	HASHKEY *seen;
+	int seen_size;
+	int seen_count;
+	int games;
+	BITBOARD positions;
+	BITBOARD written;
+	unsigned int start_time;
+} EXTRACT_DATA;
 
-#define TUNE_COUNT 11
+BOOL extract_pos_func(void *arg, POS_DATA *pos);
+BOOL extract_insert(EXTRACT_DATA *data, HASHKEY hashkey);
+void extract_flush(EXTRACT_DATA *data);
+double tune_loss(PACKED_POS *pos, VALUE *score, int count, float scale);
 
-int tune_class[TUNE_COUNT][2] =
+/* Parameters that aren't tuned: these are used as weights for indexing
+	other tables, or aren't really evaluation terms at all. */
+char *tune_skip[] =
 {
-	{ -MATE,	-450 },
-	{ -449,		-350 },
-	{ -349,		-250 },
-	{ -249,		-150 },
-	{ -149,		-50 },
-	{ -49,		50 },
-	{ 51,		150 },
-	{ 151,		250 },
-	{ 251,		350 },
-	{ 351,		450 },
-	{ 451,		MATE },
+	"King Safety Attack Weight",
+	"King Safety Block Weight",
+	"King Safety Defense Weight",
+	"Lazy Eval Margin",
+	NULL
 };
 
-int param;
+/* Settings for the Adam optimizer. The learning rate is in centipawns. */
+#define TUNE_RATE		(1.0)
+#define TUNE_BETA_1		(0.9)
+#define TUNE_BETA_2		(0.999)
+#define TUNE_EPSILON	(1.0e-8)
+
+/* The evaluation is linearized around the current parameters by bumping each
+	parameter by TUNE_STEP, which is big enough to survive the rounding in
+	interpolate(). This is redone every TUNE_RELINEARIZE iterations. */
+#define TUNE_STEP			(8)
+#define TUNE_RELINEARIZE	(100)
+
+/* The linearized evaluation: for each parameter, the positions whose
+	evaluation it changes, and by how much per unit. The entries for parameter
+	p are from start[p] to start[p + 1]. */
+typedef struct
+{
+	int *start;
+	int *pos;
+	float *coef;
+	int size;
+	int count;
+} TUNE_MODEL;
+
+void tune_linearize(TUNE_MODEL *model, PACKED_POS *pos, VALUE *score,
+	VALUE *new_score, int count, VALUE **param, int param_count);
+double tune_model_gradient(TUNE_MODEL *model, PACKED_POS *pos, VALUE *score,
+	int count, double *delta, double *gradient, int param_count, float scale,
+	float *eval);
 
 /**
-tune_pgn():
-Given a PGN with good quality games, tune the evaluation function in order to
-better predict either the result of the games.
-Created 110506; last modified 082408
+extract_positions():
+Streams through a PGN file and writes out the positions that are suitable for
+tuning, along with the results of their games, either as FEN strings or as
+packed positions for tune_eval(). A position is kept if:
+-it is at least min_ply plies into the game
+-the game has a result (only decisive ones if decisive is set)
+-the side to move isn't in check
+-the material balance is no more than max_balance (if max_balance > 0)
+-it hasn't been seen before
+-the qsearch value is within margin of the static eval
+The qsearch and eval are done in batches with evaluate_batch(), so they are
+spread over all processors.
+Created 101926; last modified 101926
 **/
-void tune_pgn(char *file_name)
+void extract_positions(char *pgn_name, char *out_name, BOOL fen, int min_ply,
+	VALUE margin, VALUE max_balance, BOOL decisive)
 {
-	int game;
-	int game_count;
-	TUNE_DATA tune_data[TUNE_COUNT];
-	VALUE eval;
-	VALUE p_eval;
-	float prob;
-	int class;
-	int count;
+	int games;
+	EXTRACT_DATA extract_data;
+	EXTRACT_DATA *data = &extract_data;
 
-	/* Open the pgn file. */
-	game_count = pgn_open(file_name);
-	if (game_count == -1)
-		return;
-	if (game_count == 0)
+	if ((data->file = fopen(out_name, fen ? "wt" : "wb")) == NULL)
 	{
-		print("%s: no games found.\n", file_name);
+		print("%s: could not open file.\n", out_name);
 		return;
 	}
 
-	/* Initialize the tuning data. We keep the old params to back up later. */
-	initialize_params(old_params);
-	copy_params(eval_parameter, old_params);
+	data->fen = fen;
+	data->min_ply = min_ply;
+	data->margin = margin;
+	data->max_balance = max_balance;
+	data->decisive = decisive;
+
+	data->pos = malloc(EXTRACT_BATCH * sizeof(PACKED_POS));
+	data->eval = malloc(EXTRACT_BATCH * sizeof(VALUE));
+	data->q_eval = malloc(EXTRACT_BATCH * sizeof(VALUE));
+	data->fen_string = data->fen ? malloc(EXTRACT_BATCH * 128) : NULL;
+	data->seen_size = 1 << 16;
+	data->seen = calloc(data->seen_size, sizeof(HASHKEY));
+	if (data->pos == NULL || data->eval == NULL || data->q_eval == NULL ||
+		(data->fen && data->fen_string == NULL) || data->seen == NULL)
+		fatal_error("fatal error: could not allocate extraction data");
+	data->count = 0;
+	data->seen_count = 0;
+	data->games = 0;
+	data->positions = 0;
+	data->written = 0;
+	data->start_time = get_time();
+
 	zct->engine_state = ANALYZING;
-	param = 8; /* bishop pair */
+	games = pgn_stream(pgn_name, extract_pos_func, (void *)data);
+	extract_flush(data);
+	zct->engine_state = IDLE;
 
-	/* Run the loop over the games over and over, determining the match
-		score and tuning based on this. */
-	while (TRUE)
+	if (games != -1)
 	{
-		/* Initialize. */
-		hash_clear();
-		for (class = 0; class < TUNE_COUNT; class++)
-		{
-			tune_data[class].count = 0;
-			tune_data[class].points = 0;
-			tune_data[class].total = 0;
-			tune_data[class].param_total = 0;
-		}
-		
-		/* Read each game and run the tuning procedure. */
-		for (game = 1; game <= game_count; game++)
+		print("games=%i positions=%L unique=%i written=%L positions/sec=%i\n",
+			games, data->positions, data->seen_count, data->written,
+			(int)(data->positions * 1000 /
+			MAX(get_time() - data->start_time, 1)));
+		print("%L positions written to %s.\n", data->written, out_name);
+	}
+	fclose(data->file);
+
+	free(data->pos);
+	free(data->eval);
+	free(data->q_eval);
+	if (data->fen_string != NULL)
+		free(data->fen_string);
+	free(data->seen);
+}
+
+/**
+extract_pos_func():
+This plugs into the PGN parser to apply the cheap filters to each position,
+and queue up the ones that pass for the qsearch filter.
+Created 101926; last modified 101926
+**/
+BOOL extract_pos_func(void *arg, POS_DATA *pos)
+{
+	EXTRACT_DATA *data = (EXTRACT_DATA *)arg;
+	PACKED_POS *packed;
+	CMD_INPUT saved_input;
+	int cmd_result;
+	int result;
+
+	data->positions++;
+	if (board.game_entry == board.game_stack + 1)
+		data->games++;
+
+	if (!strncmp(pos->pgn->tag.result, "1-0", 3))
+		result = 2;
+	else if (!strncmp(pos->pgn->tag.result, "0-1", 3))
+		result = 0;
+	else if (!strncmp(pos->pgn->tag.result, "1/2-1/2", 7))
+		result = 1;
+	/* No result, so this game is no use to us. */
+	else
+		return FALSE;
+
+	if (data->decisive && result == 1)
+		return FALSE;
+	if (board.game_entry - board.game_stack < data->min_ply)
+		return FALSE;
+	if (in_check())
+		return FALSE;
+	if (data->max_balance > 0 && ABS(material_balance()) > data->max_balance)
+		return FALSE;
+
+	/* Only mark the position as seen once it's packed, so that positions
+		that can't be packed don't count as duplicates. */
+	packed = &data->pos[data->count];
+	if (!pack_position(packed))
+		return FALSE;
+	if (!extract_insert(data, board.hashkey))
+		return FALSE;
+	packed->result = result;
+	if (data->fen)
+		strcpy(data->fen_string[data->count], fen_string(&board));
+	data->count++;
+
+	if (data->count == EXTRACT_BATCH)
+	{
+		extract_flush(data);
+		print("games=%i positions=%L written=%L positions/sec=%i\n",
+			data->games, data->positions, data->written,
+			(int)(data->positions * 1000 / MAX(get_time() -
+			data->start_time, 1)));
+		/* Check for the user stopping the extraction. The PGN parser is
+			still going through the arguments in cmd_input, so give the
+			command its own copy, and put the parser's back afterwards. */
+		if (input_available())
 		{
-			if (game % 100 == 0)
-				print(".");
-			pgn_load(game, tune_pgn_func, (void *)tune_data);
+			read_line();
+			saved_input = cmd_input;
+			cmd_input.input = NULL;
+			cmd_input.old_input = NULL;
+			cmd_input.args = NULL;
+			cmd_input.arg = NULL;
+			cmd_result = command(zct->input_buffer);
+			free(cmd_input.input);
+			free(cmd_input.old_input);
+			free(cmd_input.args);
+			free(cmd_input.arg);
+			cmd_input = saved_input;
+			if (cmd_result != CMD_BAD)
+				return TRUE;
 		}
+	}
+	return FALSE;
+}
 
-		print("\nParam %i:\n", param);
-		for (class = 0; class < TUNE_COUNT; class++)
-		{
-			if (tune_data[class].count == 0)
-				continue;
+/**
+extract_insert():
+Adds a hashkey to the set of positions seen so far. Returns FALSE if it was
+already there.
+Created 101926; last modified 101926
+**/
+BOOL extract_insert(EXTRACT_DATA *data, HASHKEY hashkey)
+{
+	int x;
+	int old_size;
+	HASHKEY *old_seen;
 
-			count = tune_data[class].count;
-			eval = tune_data[class].total / count;
-			p_eval = tune_data[class].param_total / count;
-			prob = (float)tune_data[class].points / (count * 2);
+	/* Keep the table at most half full, so that probes are short. */
+	if (data->seen_count * 2 >= data->seen_size)
+	{
+		old_size = data->seen_size;
+		old_seen = data->seen;
+		data->seen_size *= 2;
+		data->seen = calloc(data->seen_size, sizeof(HASHKEY));
+		if (data->seen == NULL)
+			fatal_error("fatal error: could not allocate extraction data");
+		data->seen_count = 0;
+		for (x = 0; x < old_size; x++)
+			if (old_seen[x] != 0)
+				extract_insert(data, old_seen[x]);
+		free(old_seen);
+	}
 
-			print("\tpos=%i score=%.2f eval=(%V %O) p eval=(%V %O)\n",
-				count, prob, eval, eval, p_eval, p_eval);
-		}
-	//	bishop_pair_value += p_eval - eval;
+	/* A zero hashkey marks an empty slot. */
+	if (hashkey == 0)
+		hashkey = 1;
+	for (x = hashkey & (data->seen_size - 1); data->seen[x] != 0;
+		x = (x + 1) & (data->seen_size - 1))
+	{
+		if (data->seen[x] == hashkey)
+			return FALSE;
+	}
+	data->seen[x] = hashkey;
+	data->seen_count++;
+	return TRUE;
+}
+
+/**
+extract_flush():
+Runs the qsearch filter over the queued positions, and writes out the ones
+that pass.
+Created 101926; last modified 101926
+**/
+void extract_flush(EXTRACT_DATA *data)
+{
+	char *result[3] = { "0-1", "1/2-1/2", "1-0" };
+	int x;
+
+	if (data->count == 0)
+		return;
+	evaluate_batch(data->pos, data->eval, data->count, BATCH_EVAL);
+	evaluate_batch(data->pos, data->q_eval, data->count, BATCH_QSEARCH);
+
+	for (x = 0; x < data->count; x++)
+	{
+		if (ABS(data->q_eval[x] - data->eval[x]) > data->margin)
+			continue;
+		if (data->fen)
+			fprintf(data->file, "%s c9 \"%s\";\n", data->fen_string[x],
+				result[data->pos[x].result]);
+		else
+			fwrite(&data->pos[x], sizeof(PACKED_POS), 1, data->file);
+		data->written++;
+	}
+	data->count = 0;
+}
+
+/**
+tune_loss():
+Returns the average logistic loss (cross entropy) of a set of evaluations,
+from the side to move's point of view, against the game results, with the
+evaluations scaled by the given factor before being converted to win
+probabilities.
+Created 101926; last modified 101926
+**/
+double tune_loss(PACKED_POS *pos, VALUE *score, int count, float scale)
+{
+	double loss;
+	float prob;
+	float result;
+	int value;
+	int x;
+
+	loss = 0;
+	for (x = 0; x < count; x++)
+	{
+		value = (pos[x].side_tm == WHITE ? score[x] : -score[x]) * scale;
+		value = MAX(-MATE, MIN(MATE, value));
+		prob = value_to_prob((VALUE)value) / 100;
+		prob = MAX(1.0e-6, MIN(1.0 - 1.0e-6, prob));
+		result = (float)pos[x].result / 2;
+		loss -= result * log(prob) + (1 - result) * log(1 - prob);
+	}
+	return loss / count;
+}
+
+/**
+tune_linearize():
+Finds the linearized evaluation around the current parameters. Each parameter
+is bumped by TUNE_STEP, and all of the positions are reevaluated with
+evaluate_batch(), which spreads the work out over all of the processors. The
+positions whose evaluation changes are stored with the change per unit.
+Created 101926; last modified 101926
+**/
+void tune_linearize(TUNE_MODEL *model, PACKED_POS *pos, VALUE *score,
+	VALUE *new_score, int count, VALUE **param, int param_count)
+{
+	int p;
+	int x;
+
+	model->count = 0;
+	for (p = 0; p < param_count; p++)
+	{
+		model->start[p] = model->count;
 
-		if (zct->input_buffer[0] != '\0')
+		*param[p] += TUNE_STEP;
+		initialize_eval();
+		evaluate_batch(pos, new_score, count, BATCH_EVAL);
+		*param[p] -= TUNE_STEP;
+
+		for (x = 0; x < count; x++)
 		{
-			if (command(zct->input_buffer) != CMD_BAD)
+			if (new_score[x] == score[x])
+				continue;
+			if (model->count == model->size)
 			{
-				print_params(old_params);
-				break;
+				model->size = model->size * 2 + count;
+				model->pos = realloc(model->pos, model->size * sizeof(int));
+				model->coef = realloc(model->coef,
+					model->size * sizeof(float));
+				if (model->pos == NULL || model->coef == NULL)
+					fatal_error("fatal error: could not allocate tuning "
+						"data");
 			}
+			model->pos[model->count] = x;
+			model->coef[model->count] =
+				(float)(new_score[x] - score[x]) / TUNE_STEP;
+			model->count++;
 		}
 	}
-	copy_params(old_params, eval_parameter);
-	free_params(old_params);
+	model->start[param_count] = model->count;
+	initialize_eval();
 }
 
 /**
-modify_eval():
-During an autotuning run, the evaluation parameters are modified and then test to see if the change is better or worse.
-Created 101907; last modified 101907
+tune_model_gradient():
+Evaluates the positions with the linearized evaluation, with each parameter
+moved by delta from where it was linearized, and returns the loss. The
+gradient of the loss with respect to each parameter is put in gradient. This
+is the same loss as tune_loss(), only with the evaluations in floating point.
+Created 101926; last modified 101926
 **/
-void modify_eval(EVAL_PARAMETER *param, int stagnancy)
+double tune_model_gradient(TUNE_MODEL *model, PACKED_POS *pos, VALUE *score,
+	int count, double *delta, double *gradient, int param_count, float scale,
+	float *eval)
 {
-	int change;
-	int dim[2];
-	/*
-	int range;
-	int lower_bound;
-	*/
-	int param_count;
-	float factor;
-	EVAL_PARAMETER *p;
-	BITBOARD random;
-	VALUE *value;
-
-	for (param_count = 0; param[param_count].value != NULL; param_count++)
-		;
-	for (change = 0; change < 4 - MIN(stagnancy / 4, 1); change++)
+	double loss;
+	double prob;
+	double result;
+	double value;
+	double sign;
+	int p;
+	int x;
+
+	for (x = 0; x < count; x++)
+		eval[x] = score[x];
+	for (p = 0; p < param_count; p++)
 	{
-		/* Select a parameter to modify. */
-		random = random_hashkey();
-		/* Some common ranges:
-			lb=0 r=1		Piece values
-			lb=1 r=1		Piece square tables
-			lb=4 r=4		Pawn structure
-			lb=11 r=2		Mobility
-			lb=13 r=7		King safety
-		*/
-//		lower_bound = 13;
-//		range = 7;
-		p = &param[((unsigned int)random) % param_count];
-		dim[0] = dim[1] = 0;
-		switch (p->dimensions)
-		{
-			case 0:
-				value = p->value;
-				break;
-			case 1:
-				dim[0] = (unsigned int)(random >> 16) % p->dimension[0];
-				value = &p->value[dim[0]];
-				break;
-			case 2:
-				dim[0] = (unsigned int)(random >> 16) % p->dimension[0];
-				dim[1] = (unsigned int)(random >> 32) % p->dimension[1];
-				value = &p->value[dim[0] * p->dimension[1] + dim[1]];
-				break;
-			default:
-				print("Bad data in eval parameters: dimension %i == %i\n", p - param, p->dimensions);
-				value = NULL;
-		}
-		/* Now modify the parameter by a factor between .618 and 1.618. This is
-			to give an even distribution between increasing and decreasing with
-			a range of factors of exactly 1. It's the golden ratio, for those
-			of you who are nerdily inclined... */
-		factor = (float)(random >> 48) / (2 * 0xFFFF) + 0.7807764064;
-		print("Modifying %i[%i][%i] by %.3f: %i to %i\n",p-param,dim[0],dim[1],factor,*value,(int)((float)*value * factor));
-		*value = (int)((float)*value * factor) + (random % 5 - 2);
+		if (delta[p] == 0)
+			continue;
+		for (x = model->start[p]; x < model->start[p + 1]; x++)
+			eval[model->pos[x]] += model->coef[x] * delta[p];
+	}
+
+	/* Find the loss, and replace each evaluation with the derivative of the
+		loss with respect to it. */
+	loss = 0;
+	for (x = 0; x < count; x++)
+	{
+		sign = (pos[x].side_tm == WHITE ? scale : -scale);
+		value = MAX(-MATE, MIN(MATE, eval[x] * sign));
+		prob = 1 / (1 + pow(10.0, -value / 400));
+		prob = MAX(1.0e-6, MIN(1.0 - 1.0e-6, prob));
+		result = (double)pos[x].result / 2;
+		loss -= result * log(prob) + (1 - result) * log(1 - prob);
+		eval[x] = (prob - result) * log(10.0) / 400 * sign / count;
+	}
+
+	for (p = 0; p < param_count; p++)
+	{
+		gradient[p] = 0;
+		for (x = model->start[p]; x < model->start[p + 1]; x++)
+			gradient[p] += model->coef[x] * eval[model->pos[x]];
 	}
+	return loss / count;
 }
 
 /**
-tune_pgn_func():
-This command plugs into the PGN parser to run the tuning procedure on the game.
-Created 020908; last modified 020908
+tune_eval():
+Tunes the eval parameters on a binary file of positions and game results, as
+written by extract_positions(). Rather than reevaluating every position for
+every parameter each iteration, the evaluation is linearized around the
+current parameters every TUNE_RELINEARIZE iterations, and the iterations in
+between use the exact gradient of the linearized evaluation. The parameters
+are updated with Adam. After the given number of iterations, or when "exit" is
+entered, the parameters are written to the given file as evalparam commands.
+Created 101926; last modified 101926
 **/
-BOOL tune_pgn_func(void *arg, PGN_GAME *pgn_game)
+void tune_eval(char *file_name, int iterations, char *ini_name)
 {
-	TUNE_DATA *data = (TUNE_DATA *)arg;
-	COLOR winner;
-	BOOL drawn;
-	EVAL_BLOCK eval_block;
-	VALUE save_param;
-	VALUE value_1;
-	VALUE value_2;
-	int class;
-
-	/* Determine the game result. */
-	winner = EMPTY;
-	drawn = FALSE;
-	if (!strncmp(pgn_game->tag.result, "1-0", 3))
-		winner = WHITE;
-	else if (!strncmp(pgn_game->tag.result, "0-1", 3))
-		winner = BLACK;
-	else
-		drawn = TRUE;
-	/* The first 10 moves are skipped, as they're typically handled by books. */
-	if (board.game_entry <= board.game_stack + 10)
-		return FALSE;
+	char out_name[256];
+	int count;
+	int param_count;
+	int iteration;
+	int p;
+	int x;
+	int active;
+	double loss;
+	double model_loss;
+	double *gradient;
+	double *theta;
+	double *delta;
+	double *m;
+	double *v;
+	float scale;
+	float low;
+	float high;
+	float *eval;
+	FILE *file;
+	PACKED_POS *pos;
+	TUNE_MODEL model;
+	VALUE **param;
+	VALUE *score;
+	VALUE *new_score;
+
+	if (zct->feature_eval)
+	{
+		print("The feature evaluator can't be tuned with evalparams.\n");
+		return;
+	}
+
+	/* Commands entered while tuning reuse the command input, so save the
+		output file name. */
+	strncpy(out_name, ini_name, sizeof(out_name) - 1);
+	out_name[sizeof(out_name) - 1] = '\0';
+
+	/* Read in the positions. */
+	if ((file = fopen(file_name, "rb")) == NULL)
+	{
+		print("%s: file not found.\n", file_name);
+		return;
+	}
+	fseek(file, 0, SEEK_END);
+	count = ftell(file) / sizeof(PACKED_POS);
+	rewind(file);
+	if (count == 0)
+	{
+		print("%s: no positions found.\n", file_name);
+		fclose(file);
+		return;
+	}
+	pos = malloc(count * sizeof(PACKED_POS));
+	score = malloc(count * sizeof(VALUE));
+	new_score = malloc(count * sizeof(VALUE));
+	eval = malloc(count * sizeof(float));
+	if (pos == NULL || score == NULL || new_score == NULL || eval == NULL)
+		fatal_error("fatal error: could not allocate tuning data");
+	count = fread(pos, sizeof(PACKED_POS), count, file);
+	fclose(file);
+	print("%i positions loaded.\n", count);
 
-//	if (is_quiet())
+	/* Find all of the values that we can tune. */
+	param_count = get_param_values(NULL);
+	param = malloc(param_count * sizeof(VALUE *));
+	gradient = calloc(param_count, sizeof(double));
+	theta = calloc(param_count, sizeof(double));
+	delta = calloc(param_count, sizeof(double));
+	m = calloc(param_count, sizeof(double));
+	v = calloc(param_count, sizeof(double));
+	model.start = malloc((param_count + 1) * sizeof(int));
+	model.pos = NULL;
+	model.coef = NULL;
+	model.size = 0;
+	model.count = 0;
+	if (param == NULL || gradient == NULL || theta == NULL || delta == NULL ||
+		m == NULL || v == NULL || model.start == NULL)
+		fatal_error("fatal error: could not allocate tuning data");
+	param_count = 0;
+	for (p = 0; eval_parameter[p].value != NULL; p++)
 	{
-		/* First get the regular evaluation. */
-	//	value_1 = evaluate(&eval_block);
-	search_call(&board.search_stack[0], FALSE, 1 * PLY, 1, -MATE, MATE,
-		board.move_stack, NODE_PV, SEARCH_RETURN);
-	value_1 = search(&board.search_stack[1]);
-
-		/* Now take out the influence of the eval parameter and reevaluate. */
-		save_param = *eval_parameter[param].value;
-		*eval_parameter[param].value = 0;
-	//	value_2 = evaluate(&eval_block);
-	search_call(&board.search_stack[0], FALSE, 1 * PLY, 1, -MATE, MATE,
-		board.move_stack, NODE_PV, SEARCH_RETURN);
-	value_2 = search(&board.search_stack[1]);
-		*eval_parameter[param].value = save_param;
-
-//			print("%V %V\n%B", value_1, value_2, &board);
-//			getln(stdin);
-		/* Now update the totals if the parameter has an effect. */
-		if (value_1 != value_2 && value_1 > -MATE + MAX_PLY &&
-			value_1 < MATE - MAX_PLY)
+		for (x = 0; tune_skip[x] != NULL; x++)
+			if (!strcmp(eval_parameter[p].name, tune_skip[x]))
+				break;
+		if (tune_skip[x] != NULL)
+			continue;
+		for (x = 0; x < param_size(&eval_parameter[p]); x++)
 		{
-			/* Find which class of data this data point is in. */
-			for (class = 0; class < TUNE_COUNT; class++)
-			{
-				if (value_1 >= tune_class[class][0] &&
-					value_1 <= tune_class[class][1])
-					break;
-			}
-			if (class == TUNE_COUNT)
-				fatal_error("Bad evaluation: %V\n%B", value_1, &board);
+			/* The king and empty piece values aren't material. */
+			if (&eval_parameter[p].value[x] == &piece_value[KING] ||
+				&eval_parameter[p].value[x] == &piece_value[EMPTY])
+				continue;
+			param[param_count] = &eval_parameter[p].value[x];
+			theta[param_count] = *param[param_count];
+			param_count++;
+		}
+	}
 
-			data[class].count++;
-			if (drawn)
-				data[class].points++;
-			else if (winner == board.side_tm)
-				data[class].points += 2;
+	/* Find the scaling factor for the evaluations that best fits the results
+		before tuning, so that the tuning doesn't just scale the whole
+		evaluation up or down. */
+	evaluate_batch(pos, score, count, BATCH_EVAL);
+	low = 0.1;
+	high = 4.0;
+	while (high - low > 0.001)
+	{
+		if (tune_loss(pos, score, count, low + (high - low) / 3) <
+			tune_loss(pos, score, count, high - (high - low) / 3))
+			high = high - (high - low) / 3;
+		else
+			low = low + (high - low) / 3;
+	}
+	scale = (low + high) / 2;
+	loss = tune_loss(pos, score, count, scale);
+	print("scale=%.3f loss=%.6f\n", scale, loss);
 
-			data[class].total += value_1;
-			data[class].param_total += value_1 - value_2;
+	for (iteration = 1; iteration <= iterations; iteration++)
+	{
+		/* Linearize the evaluation around the current parameters, rounded to
+			the values that are actually used. Parameters that didn't change
+			any evaluation last time are tried again here. */
+		if ((iteration - 1) % TUNE_RELINEARIZE == 0)
+		{
+			for (x = 0; x < param_count; x++)
+				*param[x] = (VALUE)floor(theta[x] + 0.5);
+			initialize_eval();
+			evaluate_batch(pos, score, count, BATCH_EVAL);
+			loss = tune_loss(pos, score, count, scale);
+			tune_linearize(&model, pos, score, new_score, count, param,
+				param_count);
+			active = 0;
+			for (x = 0; x < param_count; x++)
+				if (model.start[x + 1] > model.start[x])
+					active++;
+			print("iteration=%i loss=%.6f active=%i/%i coefficients=%i\n",
+				iteration, loss, active, param_count, model.count);
+		}
+
+		/* Find the gradient from the linearized evaluation. */
+		for (x = 0; x < param_count; x++)
+			delta[x] = theta[x] - *param[x];
+		model_loss = tune_model_gradient(&model, pos, score, count, delta,
+			gradient, param_count, scale, eval);
+		if (iteration % 10 == 0)
+			print("iteration=%i model loss=%.6f\n", iteration, model_loss);
+
+		/* Take a step. */
+		for (x = 0; x < param_count; x++)
+		{
+			m[x] = TUNE_BETA_1 * m[x] + (1 - TUNE_BETA_1) * gradient[x];
+			v[x] = TUNE_BETA_2 * v[x] +
+				(1 - TUNE_BETA_2) * gradient[x] * gradient[x];
+			theta[x] -= TUNE_RATE * (m[x] / (1 - pow(TUNE_BETA_1, iteration))) /
+				(sqrt(v[x] / (1 - pow(TUNE_BETA_2, iteration))) +
+				TUNE_EPSILON);
+		}
+
+		/* Check for the user stopping the tuning. */
+		if (input_available())
+		{
+			read_line();
+			if (command(zct->input_buffer) != CMD_BAD)
+				break;
 		}
 	}
 
-	return FALSE;
+	/* Set the final parameters, and check them against the real evaluation. */
+	for (x = 0; x < param_count; x++)
+		*param[x] = (VALUE)floor(theta[x] + 0.5);
+	initialize_eval();
+	evaluate_batch(pos, score, count, BATCH_EVAL);
+	print("final loss=%.6f\n", tune_loss(pos, score, count, scale));
+
+	if (save_params(eval_parameter, out_name))
+		print("Parameters written to %s.\n", out_name);
+	else
+		print("%s: could not open file.\n", out_name);
+
+	/* The board's incremental material was set up with the old values. */
+	initialize_bitboards();
+
+	free(pos);
+	free(score);
+	free(new_score);
+	free(eval);
+	free(param);
+	free(gradient);
+	free(theta);
+	free(delta);
+	free(m);
+	free(v);
+	free(model.start);
+	free(model.pos);
+	free(model.coef);
 }
 
 /**
@@ -25,7 +25,7 @@
 /**
 unmake_move():
 Unmakes the last move on the internal board.
-Created 070905; last modified 050408
+Created 070905; last modified 101926
 **/
 void unmake_move()
 {
@@ -50,6 +50,10 @@ void unmake_move()
 	board.hashkey = board.game_entry->hashkey;
 	board.path_hashkey = board.game_entry->path_hashkey;
 	board.pawn_entry.hashkey = board.game_entry->pawn_hashkey;
+	board.feature_acc[WHITE][0] = board.game_entry->feature_acc[WHITE][0];
+	board.feature_acc[WHITE][1] = board.game_entry->feature_acc[WHITE][1];
+	board.feature_acc[BLACK][0] = board.game_entry->feature_acc[BLACK][0];
+	board.feature_acc[BLACK][1] = board.game_entry->feature_acc[BLACK][1];
 	move = board.game_entry->move;
 	cap = board.game_entry->capture;
 
@@ -76,6 +80,13 @@ void unmake_move()
 		board.piece_count[board.side_tm]--;
 		board.material[board.side_tm] -=
 			piece_value[promote] - piece_value[PAWN];
+		board.psq_opening[board.side_tm] -=
+			piece_square_value[board.side_tm][promote][to] -
+			piece_square_value[board.side_tm][PAWN][to];
+		board.psq_endgame[board.side_tm] -=
+			piece_endgame_value[promote] - piece_endgame_value[PAWN];
+		board.piece_type_count[PAWN]++;
+		board.piece_type_count[promote]--;
 		piece = PAWN;
 	}
 
@@ -87,6 +98,10 @@ void unmake_move()
 	SET_BIT(board.occupied_bb, from);
 	board.piece[from] = piece;
 	board.color[from] = board.side_tm;
+	if (piece != KING)
+		board.psq_opening[board.side_tm] -=
+			piece_square_value[board.side_tm][piece][to] -
+			piece_square_value[board.side_tm][piece][from];
 
 	/* Restore the TO square based on whether the move was a capture or not. */
 	if (cap == EMPTY)
@@ -106,6 +121,10 @@ void unmake_move()
 		else
 			board.piece_count[board.side_ntm]++;
 		board.material[board.side_ntm] += piece_value[cap];
+		board.psq_opening[board.side_ntm] +=
+			piece_square_value[board.side_ntm][cap][to];
+		board.psq_endgame[board.side_ntm] += piece_endgame_value[cap];
+		board.piece_type_count[cap]++;
 	}
 
 	/* En passant. */
@@ -119,6 +138,10 @@ void unmake_move()
 		board.piece[ep_square] = PAWN;
 		board.pawn_count[board.side_ntm]++;
 		board.material[board.side_ntm] += piece_value[PAWN];
+		board.psq_opening[board.side_ntm] +=
+			piece_square_value[board.side_ntm][PAWN][ep_square];
+		board.psq_endgame[board.side_ntm] += piece_endgame_value[PAWN];
+		board.piece_type_count[PAWN]++;
 	}
 	else if (piece == KING)
 	{
@@ -146,6 +169,9 @@ void unmake_move()
 			board.color[castle_from] = board.side_tm;
 			board.piece[castle_to] = EMPTY;
 			board.piece[castle_from] = ROOK;
+			board.psq_opening[board.side_tm] -=
+				piece_square_value[board.side_tm][ROOK][castle_to] -
+				piece_square_value[board.side_tm][ROOK][castle_from];
 		}
 	}
 }
@@ -20,11 +20,12 @@
 #include "zct.h"
 #include "functions.h"
 #include "globals.h"
+#include "bit.h"
 
 /**
 verify():
 Verifies the integrity of the various board information, based on the piece and color arrays.
-Created 071505; last modified 011208
+Created 071505; last modified 101926
 **/
 void verify(void)
 {
@@ -53,6 +54,13 @@ void verify(void)
 			print("piece_bb[%P]:\n%lI", p, old_board.piece_bb[p],
 				board.piece_bb[p]);
 		}
+		/* Check the piece type counts. */
+		if (old_board.piece_type_count[p] != board.piece_type_count[p])
+		{
+			fail = TRUE;
+			print("piece_type_count[%P]: %i %i\n", p,
+				old_board.piece_type_count[p], board.piece_type_count[p]);
+		}
 	}
 	for (c = WHITE; c <= BLACK; c++)
 	{
@@ -84,6 +92,25 @@ void verify(void)
 			print("material[%C]: %i %i\n", c, old_board.material[c],
 				board.material[c]);
 		}
+		/* Check the piece square sums. */
+		if (old_board.psq_opening[c] != board.psq_opening[c] ||
+			old_board.psq_endgame[c] != board.psq_endgame[c])
+		{
+			fail = TRUE;
+			print("psq[%C]: %i %i %i %i\n", c, old_board.psq_opening[c],
+				board.psq_opening[c], old_board.psq_endgame[c],
+				board.psq_endgame[c]);
+		}
+		/* The feature accumulators are only updated when they're used. */
+		if (zct->feature_eval &&
+			(old_board.feature_acc[c][0] != board.feature_acc[c][0] ||
+			old_board.feature_acc[c][1] != board.feature_acc[c][1]))
+		{
+			fail = TRUE;
+			print("feature_acc[%C]: %i %i %i %i\n", c,
+				old_board.feature_acc[c][0], board.feature_acc[c][0],
+				old_board.feature_acc[c][1], board.feature_acc[c][1]);
+		}
 	}
 	/* Check the hashkey. */
 	if (board.hashkey != old_board.hashkey)
@@ -217,3 +244,71 @@ BOOL move_is_valid(MOVE move)
 	}
 	return TRUE;
 }
+
+/**
+move_is_legal():
+Tests if a pseudo-legal move, as checked by move_is_valid(), is also legal, so
+that it can be made without testing for check afterwards.
+Created 101926; last modified 101926
+**/
+BOOL move_is_legal(SEARCH_BLOCK *sb, MOVE move)
+{
+	BOOL r;
+	BITBOARD old_occupied_bb;
+	BITBOARD pinners;
+	BITBOARD pinner_piece;
+	DIRECTION dir;
+	SQUARE from;
+	SQUARE to;
+	SQUARE king;
+
+	from = MOVE_FROM(move);
+	to = MOVE_TO(move);
+	king = board.king_square[board.side_tm];
+
+	/* Evasions and en passant captures are rare enough that we can just use
+		the slow test. */
+	if (sb->check || (board.piece[from] == PAWN && to == board.ep_square))
+		return is_legal(move);
+
+	if (from == king)
+	{
+		/* Castling is fully checked in move_is_valid(). */
+		if (ABS(to - from) == 2)
+			return TRUE;
+		/* Take the king off the board, so that it doesn't block attacks on
+			the squares behind it. */
+		old_occupied_bb = board.occupied_bb;
+		CLEAR_BIT(board.occupied_bb, from);
+		r = !is_attacked(to, board.side_ntm);
+		board.occupied_bb = old_occupied_bb;
+		return r;
+	}
+
+	/* Only a piece that is the first one on a line from the king can be
+		pinned, which rules out most moves right away. */
+	if ((!in_between_bb[king][from] && !(king_moves_bb[king] & MASK(from))) ||
+		(in_between_bb[king][from] & board.occupied_bb))
+		return TRUE;
+
+	/* Look for a pin along the line from the king through the piece. A
+		pinned piece can still move along that line, up to the pinner. */
+	for (dir = DIR_HORI; dir <= DIR_VERT; dir++)
+	{
+		if (!(dir_attacks(king, board.occupied_bb, dir) & MASK(from)))
+			continue;
+		if (dir == DIR_HORI || dir == DIR_VERT)
+			pinner_piece = board.piece_bb[ROOK] | board.piece_bb[QUEEN];
+		else
+			pinner_piece = board.piece_bb[BISHOP] | board.piece_bb[QUEEN];
+		pinners = dir_attacks(king, board.occupied_bb ^ MASK(from), dir) &
+			board.color_bb[board.side_ntm] & pinner_piece;
+		/* We aren't in check, so there can only be one pinner, behind the
+			piece. */
+		if (pinners)
+			return (MASK(to) & (in_between_bb[king][first_square(pinners)] |
+				pinners)) != 0;
+		return TRUE;
+	}
+	return TRUE;
+}
@@ -22,6 +22,7 @@
 #include "globals.h"
 #include "eval.h"
 #include "smp.h"
+#include "profile.h"
 
 int main(char **argv, int argc)
 {
@@ -32,8 +33,11 @@ int main(char **argv, int argc)
 	initialize_data();
 	initialize_cmds();
 	initialize_eval();
+	initialize_features();
 	initialize_attacks();
 	initialize_board(NULL);
+	initialize_bitbases();
+	initialize_profile();
 #ifdef SMP
 	initialize_smp(MAX_CPUS);
 #else
@@ -217,13 +221,18 @@ void prompt(void)
 /**
 bench():
 Makes a standard measure of performance on a set of positions.
-Created 013008; last modified 031809
+Created 013008; last modified 101926
 **/
 void bench(void)
 {
 	BOOL old_post;
 	BITBOARD total_nodes;
+	BITBOARD total_full_evals;
+	BITBOARD total_pawn_hash_probes;
+	BITBOARD total_pawn_hash_hits;
 	int time;
+	int count;
+	int x;
 	struct bench_position
 	{
 		char *fen;
@@ -292,13 +301,19 @@ void bench(void)
 		{ NULL, 0 }
 	};
 	struct bench_position *current_position;
+	float pawn_hash_rate[sizeof(position) / sizeof(position[0])];
 
 	total_nodes = 0;
+	total_full_evals = 0;
+	total_pawn_hash_probes = 0;
+	total_pawn_hash_hits = 0;
+	count = 0;
 	time = get_time();
 	old_post = zct->post;
 	zct->use_book = FALSE;
 	zct->post = TRUE;
 	zct->engine_state = BENCHMARKING;
+	clear_profile();
 	print("Running benchmark");
 
 	/* Loop through the positions. */
@@ -311,15 +326,29 @@ void bench(void)
 		zct->max_depth = current_position->depth - 1;
 		search_root();
 		total_nodes += zct->nodes + zct->q_nodes;
+		total_full_evals += zct->full_evals;
+		total_pawn_hash_probes += zct->pawn_hash_probes;
+		total_pawn_hash_hits += zct->pawn_hash_hits;
+		pawn_hash_rate[count++] = (float)100.0 * zct->pawn_hash_hits /
+			MAX(1, zct->pawn_hash_probes);
 		if (zct->input_buffer[0])
 			break;
 	}
 	time = get_time() - time;
 	print("\n");
 	print_statistics();
+	print_profile();
+	print("Pawn hash hits by position:");
+	for (x = 0; x < count; x++)
+		print("%s%5.1f%%", x % 8 == 0 ? "\n" : " ", pawn_hash_rate[x]);
+	print("\n");
+	print("Pawn hash hits=%.1f%%\n", (float)100.0 * total_pawn_hash_hits /
+		MAX(1, total_pawn_hash_probes));
 	print("Total nodes=%L\n", total_nodes);
 	print("Total time=%T\n", time);
 	print("Nodes per second=%L\n", total_nodes * 1000 / time);
+	print("Full evals per node=%.3f\n",
+		(float)total_full_evals / total_nodes);
 	zct->engine_state = IDLE;
 	zct->use_book = TRUE;
 	zct->post = old_post;
@@ -261,6 +261,9 @@ typedef signed short VALUE;
 #define NO_VALUE				(-32767)
 #define MATE					(32766)
 #define DRAW					(0)
+/* Won bitbase positions score just below the mate scores, and are adjusted
+	for ply the same way. */
+#define BITBASE_WIN				(MATE - 2 * MAX_PLY)
 
 typedef unsigned char PHASE;
 
@@ -277,6 +280,9 @@ typedef struct
 	VALUE eval[2];
 	VALUE full_eval;
 	BITBOARD good_squares[2];
+	/* Every square attacked by each side, a superset when sliders x-ray
+		through their own pieces. Zero when the attacks weren't computed. */
+	BITBOARD attacks[2];
 } EVAL_BLOCK;
 
 typedef enum { KING_SIDE, QUEEN_SIDE } SHELTER;
@@ -300,11 +306,24 @@ typedef struct
 #define MAX_ROOT_MOVES			(256)
 
 typedef enum { SELECT_HASH_MOVE, SELECT_THREAT_MOVE, SELECT_GEN_MOVES,
-	SELECT_GEN_CAPS, SELECT_GEN_CHECKS, SELECT_MOVE } SELECT_STATE;
+	SELECT_GEN_CAPS, SELECT_GEN_CHECKS, SELECT_MOVE, SELECT_GOOD_CAPS,
+	SELECT_COUNTER_1, SELECT_COUNTER_2, SELECT_KILLER_1, SELECT_KILLER_2,
+	SELECT_GEN_QUIETS, SELECT_QUIETS, SELECT_BAD_CAPS } SELECT_STATE;
+
+typedef enum { GEN_ALL, GEN_CAPTURES, GEN_QUIETS } GEN_TYPE;
+
+/* Information for finding checking moves, calculated once per position: the
+	squares each piece type gives check from, and the pieces that would give a
+	discovered check by moving off the line to the enemy king. */
+typedef struct
+{
+	BITBOARD direct[6];
+	BITBOARD discovered;
+} CHECK_INFO;
 
 typedef enum { SEARCH_START, SEARCH_NULL_1, SEARCH_IID, SEARCH_JOIN, SEARCH_1,
 	SEARCH_2, SEARCH_3, SEARCH_4, QSEARCH_START, QSEARCH_1, SEARCH_WAIT,
-	SEARCH_CHILD_RETURN, SEARCH_RETURN } SEARCH_STATE;
+	SEARCH_CHILD_RETURN, SEARCH_ROOT_RETURN, SEARCH_RETURN } SEARCH_STATE;
 
 typedef enum { NODE_ALL, NODE_CUT, NODE_PV } NODE_TYPE;
 
@@ -339,16 +358,32 @@ typedef struct
 	MOVE *first_move;
 	MOVE *next_move;
 	MOVE *last_move;
+	/* Losing captures, which are deferred until after the quiet moves. */
+	MOVE *next_bad_cap;
+	MOVE *last_bad_cap;
+	/* The counter and killer moves that were actually tried at this node, so
+		that they can be skipped once the quiet moves are generated. */
+	MOVE killer[4];
 	SEARCH_STATE search_state;
 } SEARCH_BLOCK;
 
 /*
-Hash key. The structure for the 64-bit data structure is as follows:
+Hash entry. Each slot in a bucket holds a 16-bit check key and a 64-bit data
+word, so that six slots fit in a 64-byte cache line. The structure for the
+64-bit data is as follows:
 
 bits  0 -  8:	depth
-bits  9 - 10:	type: exact, upper bound, lower bound
-bits 11 - 26:	eval
-bits 27 - 45:	move
+bits  9 - 16:	age
+bits 17 - 18:	type: exact, upper bound, lower bound
+bit  19:		threat
+bits 20 - 35:	value
+bits 36 - 50:	move
+bits 51 - 63:	hashkey bits 48-60
+
+The check key is bits 32-47 of the hashkey, XORed with the folded data word
+so that torn reads and writes are detected (lockless hashing). Together with
+the hashkey bits in the data, this gives 29 bits of verification on top of
+the bucket index.
 */
 typedef BITBOARD HASHKEY;
 
@@ -358,6 +393,7 @@ typedef BITBOARD HASHKEY;
 #define SET_HASH_THREAT(t)		((BITBOARD)((t) & 0x01) << 19)
 #define SET_HASH_VALUE(s)		((BITBOARD)((s + MATE) & 0xFFFF) << 20)
 #define SET_HASH_MOVE(m)		((BITBOARD)MOVE_COMPARE(m) << 36)
+#define SET_HASH_KEY(h)			((BITBOARD)((h) >> 48 & 0x1FFF) << 51)
 
 #define HASH_DEPTH(d)			((int)((d) & 0x01FF))
 #define HASH_AGE(d)				((int)((d) >> 9 & 0xFF))
@@ -365,26 +401,38 @@ typedef BITBOARD HASHKEY;
 #define HASH_THREAT(d)			((BOOL)((d) >> 19 & 0x01))
 #define HASH_VALUE(d)			((VALUE)((d) >> 20 & 0xFFFF) - MATE)
 #define HASH_MOVE(d)			((MOVE)MOVE_COMPARE((d) >> 36))
+#define HASH_KEY(d)				((int)((d) >> 51 & 0x1FFF))
+
+/* Check key calculation and verification for a slot. */
+#define HASH_FOLD(d)			((unsigned short)((d) ^ (d) >> 16 ^		\
+									(d) >> 32 ^ (d) >> 48))
+#define HASH_CHECK(h, d)		((unsigned short)((h) >> 32) ^ HASH_FOLD(d))
+#define HASH_CHECK_MATCH(c, d, h)	((c) == HASH_CHECK(h, d))
+#define HASH_KEY_MATCH(d, h)	(HASH_KEY(d) == HASH_KEY(SET_HASH_KEY(h)))
+#define HASH_SLOT_MATCH(c, d, h)	(HASH_CHECK_MATCH(c, d, h) &&			\
+									HASH_KEY_MATCH(d, h))
 
 typedef enum { HASH_NO_BOUND, HASH_LOWER_BOUND, HASH_UPPER_BOUND,
 	HASH_EXACT_BOUND } HASH_BOUND_TYPE;
 
 /* Structure for semi-path-dependent hashing. We don't completely hash the path,
-	because we want to pick up "similar" paths. */
+	because we want to pick up "similar" paths. The path bits are the ones that
+	are stored in the data word. */
 #define HASH_PATH_MOVE_COUNT	(2)
 
 #define HASH_NON_PATH(h)		((h) & 0x0000FFFFFFFFFFFFull)
 #define HASH_PATH(h)			((h) & 0xFFFF000000000000ull)
 
-#define HASH_SLOT_COUNT			(4)
+#define HASH_SLOT_COUNT			(6)
 
 typedef struct
 {
 	struct
 	{
-		HASHKEY hashkey;
+		unsigned short check;
 		BITBOARD data;
-	} entry[HASH_SLOT_COUNT];
+	} __attribute__((packed)) entry[HASH_SLOT_COUNT];
+	unsigned int padding;
 } HASH_ENTRY;
 
 #define HASH_MB					((1 << 20) / sizeof(HASH_ENTRY))
@@ -404,8 +452,10 @@ typedef struct
 	HASHKEY hashkey;
 	BITBOARD passed_pawns;
 	BITBOARD not_attacked[2];
+	BITBOARD pawn_attacks[2];
 	unsigned char open_files[2];
 	VALUE king_shelter_value[2][2];
+	VALUE king_file_shelter[2][8]; /* shelter score by the king's file */
 	VALUE bishop_color_value[2][2];
 	VALUE eval[2];
 } PAWN_HASH_ENTRY;
@@ -424,8 +474,49 @@ typedef struct
 	HASHKEY hashkey;
 	HASHKEY path_hashkey;
 	HASHKEY pawn_hashkey;
+	int feature_acc[2][2];
 } GAME_ENTRY;
 
+/* A compact position, for handing large sets of positions around: the
+	occupied squares, and then the piece and color of each occupied square,
+	in square order, packed into four bits apiece. */
+typedef struct
+{
+	BITBOARD occupied;
+	unsigned char piece[16];
+	unsigned char side_tm;
+	unsigned char castle_rights;
+	unsigned char ep_square;
+	unsigned char fifty_count;
+	unsigned char result; /* for training data: 0-2 half points for white */
+	unsigned char padding[3];
+} PACKED_POS;
+
+/* What to compute for each position in a batch evaluation */
+typedef enum { BATCH_EVAL, BATCH_QSEARCH } BATCH_TYPE;
+
+/* A win/draw bitbase for one ending. The first king and the pieces after it
+	with color WHITE belong to the strong side, which is always white inside
+	the table; positions where black is the strong side are flipped. Each bit
+	is set when the strong side wins. Tables without pawns use all eight
+	symmetries, with the strong king in the a1-d1-d4 triangle, and tables with
+	pawns only mirror the files. */
+#define BITBASE_COUNT			(5)
+#define BITBASE_MAX_PIECES		(4)
+
+typedef struct
+{
+	char name[8];
+	int piece_count;
+	PIECE piece[BITBASE_MAX_PIECES];
+	COLOR color[BITBASE_MAX_PIECES];
+	BOOL symmetric;
+	BOOL exact; /* Every position that isn't won is a draw */
+	volatile BOOL ready;
+	BITBOARD size; /* Positions for each side to move */
+	BITBOARD *table;
+} BITBASE;
+
 #define MOVE_STACK_SIZE			(MAX_PLY * 128)
 #define GAME_STACK_SIZE			(1024)
 
@@ -441,6 +532,14 @@ typedef struct BOARD
 	int piece_count[2];
 	int pawn_count[2];
 	VALUE material[2];
+	/* Incremental evaluation terms: piece square sums (without kings), and
+		piece counts for the game phase. */
+	VALUE psq_opening[2];
+	VALUE psq_endgame[2];
+	int piece_type_count[6];
+	/* Sums of the feature evaluator's weights, from each side's point of view,
+		for the opening and endgame. */
+	int feature_acc[2][2];
 	COLOR side_tm;
 	COLOR side_ntm;
 	SQUARE ep_square;
@@ -476,6 +575,35 @@ typedef enum { IDLE, NORMAL, PONDERING, ANALYZING, INFINITE, TESTING,
 /* String hashkey, used for mapping strings into arrays */
 typedef unsigned int STR_HASHKEY;
 
+/* The move ordering tables. These are shared between all of the processors by
+	default, and are updated without any locking: a lost or stale update only
+	costs a bit of move ordering. */
+typedef struct
+{
+	unsigned int history_table[2][4096];
+	MOVE killer_move[MAX_PLY][2];
+	MOVE counter_move[2][4096][2];
+} HEURISTIC_TABLE;
+
+/* Counters for the shape of the search tree. Each processor keeps its own,
+	and sum_counters() adds them up into the global ones. */
+typedef struct
+{
+	BITBOARD pv_nodes;
+	BITBOARD fail_high_nodes;
+	BITBOARD fail_low_nodes;
+	BITBOARD pv_first;
+	BITBOARD fail_high_first;
+	BITBOARD hash_probes;
+	BITBOARD hash_hits;
+	BITBOARD hash_cutoffs;
+	BITBOARD check_extensions_done;
+	BITBOARD one_rep_extensions_done;
+	BITBOARD threat_extensions_done;
+	BITBOARD passed_pawn_extensions_done;
+	BITBOARD singular_extensions_done;
+} SEARCH_COUNTERS;
+
 /* A massive global struct with all the settings and related stuff. */
 typedef struct
 {
@@ -510,11 +638,22 @@ typedef struct
 	ROOT_MOVE *next_root_move;
 	ROOT_MOVE root_move_list[MAX_ROOT_MOVES];
 	int root_move_count;
+	MOVE search_moves[MAX_ROOT_MOVES];
+	int search_move_count;
 
 	/* Search options */
 	int max_depth;
 	int max_nodes;
 	int output_limit;
+	int aspiration_window;
+	BOOL root_split;
+	BOOL shared_heuristics;
+	int multi_pv;
+	BOOL feature_eval;
+	BOOL trace;
+	BOOL tree_stats;
+	int trace_generation;
+	char trace_name[128];
 	int lmr_threshold;
 	int singular_extension;
 	int singular_margin;
@@ -525,14 +664,12 @@ typedef struct
 
 	/* Search data, heuristics */
 	int root_pv_counter;
+	BOOL root_bitbase;
 	VALUE last_root_score;
 	VALUE best_score_by_depth[MAX_PLY];
 	int pv_changes_by_depth[MAX_PLY];
-
-	unsigned int history_counter;
-	unsigned int history_table[2][4096];
-	MOVE killer_move[MAX_PLY][2];
-	MOVE counter_move[2][4096][2];
+	int fail_highs_by_depth[MAX_PLY];
+	int fail_lows_by_depth[MAX_PLY];
 
 	HASH_ENTRY *hash_table;
 
@@ -547,26 +684,21 @@ typedef struct
 	int max_depth_reached;
 	int nodes_per_check;
 	int nodes_until_check;
-	BITBOARD pv_nodes;
-	BITBOARD fail_high_nodes;
-	BITBOARD fail_low_nodes;
-	BITBOARD pv_first;
-	BITBOARD fail_high_first;
-	BITBOARD hash_probes;
-	BITBOARD hash_hits;
-	BITBOARD hash_cutoffs;
+	SEARCH_COUNTERS counters;
+	/* The counters at the end of the last iteration */
+	SEARCH_COUNTERS iteration_counters;
+	BITBOARD iteration_nodes;
+	BITBOARD last_iteration_nodes;
 	BITBOARD hash_entries_full;
 	BITBOARD pawn_hash_probes;
 	BITBOARD pawn_hash_hits;
 	BITBOARD eval_hash_probes;
 	BITBOARD eval_hash_hits;
+	BITBOARD full_evals;
+	BITBOARD lazy_evals;
 	BITBOARD qsearch_hash_probes;
 	BITBOARD qsearch_hash_hits;
-	int check_extensions_done;
-	int one_rep_extensions_done;
-	int threat_extensions_done;
-	int passed_pawn_extensions_done;
-	int singular_extensions_done;
+	BITBOARD bitbase_hits;
 } GLOBALS;
 
 #endif /* ZCT_H */